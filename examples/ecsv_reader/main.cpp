@@ -4,6 +4,7 @@
 #include <tula/logging.h>
 #include <tula_config/config.h>
 #include <tula_config/gitversion.h>
+#include <tula/ecsv/rowindex.h>
 #include <tula/ecsv/table.h>
 #include <tula/formatter/matrix.h>
 #include <fstream>
@@ -41,6 +42,9 @@ auto parse_args(int argc, char *argv[]) {
     //=======================================================================//
     r( (        "filepath"), "The path of input ecsv file.",
                               str("filepath")),
+    r(p(             "rows"), "The rows to read, as python-like slice "
+                              "start:stop:step.",
+                              ":", str()),
     //=======================================================================//
            "common options"  % g(
     c(p(   "l", "log_level"), "Set the log level.",
@@ -66,7 +70,7 @@ auto parse_args(int argc, char *argv[]) {
     return std::move(rc);
 }
 
-auto read_ecsv(std::string filepath)
+auto read_ecsv(std::string filepath, const std::string &rows)
 {
     using namespace tula::ecsv;
     auto fmtlog = [](auto &&fmt_str, auto && ... args) {
@@ -74,10 +78,20 @@ auto read_ecsv(std::string filepath)
         SPDLOG_DEBUG(result);
     };
 
-    std::ifstream fo(filepath);
-    auto tbl = ECSVTable(ECSVHeader::read(fo));
-    auto parser = aria::csv::CsvParser(fo).delimiter(tbl.header().delimiter());
-    tbl.load_rows(parser);
+    auto tbl = [&]() {
+        if (rows != ":") {
+            // read the slice of rows via the row index of the file, which
+            // is built in memory so nothing is written next to the input
+            auto slice = tula::container_utils::parse_slice(rows);
+            return from_mmap_slice(filepath, row_index(filepath), slice);
+        }
+        std::ifstream fo(filepath);
+        auto tbl = ECSVTable(ECSVHeader::read(fo));
+        auto parser =
+            aria::csv::CsvParser(fo).delimiter(tbl.header().delimiter());
+        tbl.load_rows(parser);
+        return tbl;
+    }();
 
     fmtlog("tbl: {}", tbl);
     fmtlog("tbl_info:\n{}", tbl.info());
@@ -90,8 +104,8 @@ auto read_ecsv(std::string filepath)
     fmtlog("tbl double data: {}", tbl.array_data<double>());
     fmtlog("tbl complex data: {}", tbl.array_data<std::complex<double>>());
     fmtlog("tbl str data: {}", tbl.array_data<std::string>());
-    fmtlog("col data nw{}", tbl.col<double>("nw").data);
-    fmtlog("col data fg{}", tbl.col<double>("fg").data);
+    fmtlog("col data nw{}", tbl.col<int32_t>("nw").data);
+    fmtlog("col data fg{}", tbl.col<int64_t>("fg").data);
     fmtlog("all double data array {}", tbl.array_data<double>().array());
     return tbl;
 }
@@ -105,7 +119,7 @@ int main(int argc, char *argv[]) {
         auto filepath = rc.get_str("filepath");
         {
         tula::logging::scoped_timeit TULA_X("read ECSV table");
-        auto tbl = read_ecsv(filepath);
+        auto tbl = read_ecsv(filepath, rc.get_str("rows"));
         SPDLOG_INFO("tbl {}\n{}", filepath, tbl.info());
         }
         return EXIT_SUCCESS;
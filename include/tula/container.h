@@ -2,6 +2,7 @@
 #include "concepts.h"
 #include "eigen.h"
 #include "logging.h"
+#include <algorithm>
 #include <iterator>
 #include <regex>
 #include <ranges>
@@ -251,25 +252,30 @@ using BoundedSlice = std::tuple<T, T, T, T>;
 using BoundedIndexSlice = BoundedSlice<Eigen::Index>;
 
 /// @brief Convert slice to indices
+/// This follows python slice.indices: negative start and stop count from
+/// the end, and they are clamped to the bounds of size \p n. A zero step
+/// results in zero size.
 template <tula::meta::Integral T, tula::meta::Integral N>
 auto to_indices(Slice<T> slice, N n) noexcept {
-    BoundedSlice<T> result{
-        std::get<0>(slice).value_or(0),
-        std::get<1>(slice).value_or(n),
-        std::get<2>(slice).value_or(1),
-        0,
-    };
+    BoundedSlice<T> result{0, 0, std::get<2>(slice).value_or(1), 0};
     auto &[start, stop, step, size] = result;
-    if (start < 0) {
-        start += n;
-    }
-    if (stop < 0) {
-        start += n;
-    }
-    if (stop >= n) {
-        stop = n;
+    // the bounds of start and stop
+    T lower = step < 0 ? -1 : 0;
+    T upper = step < 0 ? T(n) - 1 : T(n);
+    auto bound = [&](const std::optional<T> &v, T default_value) {
+        if (!v.has_value()) {
+            return default_value;
+        }
+        return std::clamp(v.value() < 0 ? v.value() + T(n) : v.value(),
+                          lower, upper);
+    };
+    start = bound(std::get<0>(slice), step < 0 ? upper : lower);
+    stop = bound(std::get<1>(slice), step < 0 ? lower : upper);
+    if (step > 0 && stop > start) {
+        size = (stop - start - 1) / step + 1;
+    } else if (step < 0 && start > stop) {
+        size = (start - stop - 1) / (-step) + 1;
     }
-    size = (stop - start) / step + (((stop - start) % step) ? 1 : 0);
     return result;
 }
 
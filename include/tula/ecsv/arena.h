@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tula::ecsv {
+
+/**
+ * @brief String column stored as one contiguous byte arena and offsets.
+ *
+ * Row i is the bytes in [offsets[i], offsets[i + 1]), as in the Arrow
+ * string layout, so the column holds two allocations regardless of the
+ * number of rows, and resizing only touches the offsets.
+ *
+ * The rows are filled in order: setting row i discards the bytes of rows
+ * after i, and the rows between the last filled row and i are set to
+ * empty. Rows that are not filled yet read as empty. This is how the
+ * loader fills the columns, and it allows to reuse the arena by filling
+ * again from row zero. The column references of tables do not allow the
+ * sets that discard rows.
+ */
+struct StringArena {
+    using index_t = std::size_t;
+    using offset_t = std::uint64_t;
+    using value_t = std::string_view;
+
+    StringArena() = default;
+    explicit StringArena(index_t n) { resize(n); }
+
+    auto size() const noexcept -> index_t { return m_offsets.size() - 1; }
+    auto empty() const noexcept -> bool { return size() == 0; }
+    /// @brief The number of rows filled.
+    auto filled() const noexcept -> index_t { return m_filled; }
+
+    auto operator[](index_t idx) const noexcept -> std::string_view {
+        assert(idx < size());
+        if (idx >= m_filled) {
+            return {};
+        }
+        return std::string_view{m_bytes}.substr(
+            m_offsets[idx], m_offsets[idx + 1] - m_offsets[idx]);
+    }
+    auto at(index_t idx) const -> std::string_view {
+        if (idx >= size()) {
+            throw std::out_of_range("string arena index out of range");
+        }
+        return (*this)[idx];
+    }
+
+    /// @brief Set row \p idx to \p s. The rows after \p idx are cleared.
+    void set(index_t idx, std::string_view s) {
+        assert(idx < size());
+        fill_to(idx);
+        m_bytes.resize(m_offsets[idx]);
+        m_bytes.append(s);
+        m_offsets[idx + 1] = m_bytes.size();
+        m_filled = idx + 1;
+    }
+
+    /// @brief Resize to \p n rows. New rows are empty.
+    void resize(index_t n) {
+        m_offsets.resize(n + 1, 0);
+        if (m_filled > n) {
+            m_filled = n;
+            m_bytes.resize(m_offsets[n]);
+        }
+    }
+
+    /// @brief Reserve the arena for \p n_bytes bytes in total.
+    void reserve_bytes(std::size_t n_bytes) { m_bytes.reserve(n_bytes); }
+
+    /// @brief Copy the first \p n rows of \p other to the rows starting at
+    /// \p offset. The rows after the copied rows are cleared.
+    void assign_rows(index_t offset, const StringArena &other, index_t n) {
+        assert(offset + n <= size() && n <= other.size());
+        fill_to(offset);
+        m_bytes.resize(m_offsets[offset]);
+        auto base = m_bytes.size();
+        auto n_filled = std::min(n, other.m_filled);
+        m_bytes.append(other.m_bytes, 0, other.m_offsets[n_filled]);
+        for (index_t i = 0; i < n; ++i) {
+            m_offsets[offset + i + 1] =
+                base + other.m_offsets[std::min(i + 1, n_filled)];
+        }
+        m_filled = offset + n;
+    }
+
+    /// @brief The bytes of the filled rows.
+    auto bytes() const noexcept -> std::string_view {
+        return std::string_view{m_bytes}.substr(0, m_offsets[m_filled]);
+    }
+    /// @brief The offsets of the filled rows, of size filled() + 1.
+    auto offsets() const noexcept -> const offset_t * {
+        return m_offsets.data();
+    }
+
+    /// @brief Iterator over the rows as string views.
+    struct iterator {
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        const StringArena *arena{nullptr};
+        index_t idx{0};
+
+        auto operator*() const -> std::string_view { return (*arena)[idx]; }
+        auto operator++() -> iterator & {
+            ++idx;
+            return *this;
+        }
+        auto operator++(int) -> iterator {
+            auto it = *this;
+            ++idx;
+            return it;
+        }
+        auto operator==(const iterator &other) const -> bool {
+            return idx == other.idx;
+        }
+    };
+    auto begin() const noexcept { return iterator{this, 0}; }
+    auto end() const noexcept { return iterator{this, size()}; }
+
+    auto operator==(const StringArena &other) const -> bool {
+        return std::ranges::equal(*this, other);
+    }
+
+private:
+    std::string m_bytes;
+    std::vector<offset_t> m_offsets{0};
+    index_t m_filled{0};
+
+    /// @brief Set the rows from the last filled row up to \p idx to empty.
+    void fill_to(index_t idx) {
+        for (; m_filled < idx; ++m_filled) {
+            m_offsets[m_filled + 1] = m_offsets[m_filled];
+        }
+    }
+};
+
+} // namespace tula::ecsv
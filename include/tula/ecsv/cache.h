@@ -0,0 +1,377 @@
+#pragma once
+
+#include "../filesystem.h"
+#include "../logging.h"
+#include "../mmap.h"
+#include "table.h"
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <unistd.h>
+
+namespace tula::ecsv {
+
+/**
+ * @brief Binary columnar cache of ECSV tables.
+ *
+ * The cache file holds the ECSV header text and the column data as stored
+ * in the array data, so loading it is a copy of the column blocks instead
+ * of a parse of the text. The layout is
+ *
+ *  - preamble: magic, version, the key of the source file (size, mtime in
+ *    ns and the hash of the header text), n_rows, n_cols and the size of
+ *    the header text, as 64-bit integers.
+ *  - the header text.
+ *  - the column table: offset, size in bytes and element size of each
+ *    column block, as 64-bit integers.
+ *  - the column blocks, each aligned to \ref block_align. String columns
+ *    are stored as n_rows + 1 offsets followed by the bytes.
+ *
+ * All integers and values are in native byte order, and the cache is only
+ * used on little-endian hosts.
+ */
+namespace cache {
+
+constexpr std::array<char, 8> magic = {'T', 'U', 'L', 'A', 'E', 'C', 'S',
+                                       'V'};
+constexpr std::uint64_t version = 1;
+constexpr std::size_t block_align = 64;
+constexpr bool is_supported = std::endian::native == std::endian::little;
+
+/// @brief The key to check the cache against the source file.
+struct Key {
+    std::uint64_t size{0};
+    std::int64_t mtime{0};
+    std::uint64_t hash{0};
+
+    auto operator==(const Key &) const -> bool = default;
+};
+
+namespace internal {
+
+/// @brief 64-bit FNV-1a hash of \p s.
+constexpr auto fnv1a(std::string_view s) noexcept -> std::uint64_t {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (auto c : s) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+constexpr auto align_up(std::size_t n) noexcept -> std::size_t {
+    return (n + block_align - 1) / block_align * block_align;
+}
+
+/// @brief Read u64 at \p pos of \p buf and advance \p pos.
+inline auto read_u64(std::string_view buf, std::size_t &pos)
+    -> std::uint64_t {
+    if (pos + sizeof(std::uint64_t) > buf.size()) {
+        throw std::runtime_error("truncated ECSV cache");
+    }
+    std::uint64_t v{0};
+    std::memcpy(&v, buf.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return v;
+}
+
+template <typename OStream>
+void write_u64(OStream &os, std::uint64_t v) {
+    os.write(reinterpret_cast<const char *>(&v), sizeof(v)); // NOLINT
+}
+
+/// @brief Return a temporary path next to \p path, unique to this process
+/// and call, so concurrent writers of \p path do not share it.
+inline auto unique_tmp_path(const std::string &path) -> std::string {
+    static thread_local std::mt19937_64 gen{std::random_device{}()};
+    return fmt::format("{}.{}.{:016x}.tmp", path, ::getpid(), gen());
+}
+
+/**
+ * @brief Write file \p path with \p write_to, which is called with the
+ * output stream.
+ *
+ * The data are written to a unique temporary file, which is renamed to
+ * \p path after the stream is checked, so the file appears atomically and
+ * concurrent writers do not interleave. On failure the temporary file is
+ * removed and the error is thrown.
+ */
+template <typename F>
+void write_atomic(const std::string &path, F &&write_to) {
+    auto tmppath = unique_tmp_path(path);
+    try {
+        std::ofstream os(tmppath, std::ios::binary | std::ios::trunc);
+        if (!os) {
+            throw std::runtime_error(
+                fmt::format("unable to open {} for write", tmppath));
+        }
+        write_to(os);
+        os.close();
+        if (!os) {
+            throw std::runtime_error(
+                fmt::format("unable to write {}", tmppath));
+        }
+        std::filesystem::rename(tmppath, path);
+    } catch (...) {
+        std::error_code ec;
+        std::filesystem::remove(tmppath, ec);
+        throw;
+    }
+}
+
+} // namespace internal
+
+/// @brief Return the key of ECSV file \p filepath with header text
+/// \p header.
+inline auto make_key(const std::string &filepath, std::string_view header)
+    -> Key {
+    namespace fs = std::filesystem;
+    return {fs::file_size(filepath),
+            static_cast<std::int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    fs::last_write_time(filepath).time_since_epoch())
+                    .count()),
+            internal::fnv1a(header)};
+}
+
+/// @brief Return the default cache path of \p filepath.
+inline auto default_path(const std::string &filepath) -> std::string {
+    return filepath + ".tula_cache";
+}
+
+/// @brief Write \p tbl and its \p header text to cache file \p cachepath.
+/// Throws if the cache is not supported or the file cannot be written.
+template <TableLayout layout, StringStorage string_storage>
+void write(const BasicECSVTable<layout, string_storage> &tbl,
+           std::string_view header, const Key &key,
+           const std::string &cachepath) {
+    if constexpr (!is_supported) {
+        throw std::runtime_error("ECSV cache is not supported on this host");
+    }
+    const auto &hdr = tbl.header();
+    auto n_rows = tbl.rows();
+    auto n_cols = hdr.size();
+    if (tbl.cols() != n_cols) {
+        throw std::runtime_error("cache of column-projected table is not "
+                                 "supported");
+    }
+    // compute the column table
+    constexpr std::size_t n_preamble = 8;
+    auto pos = magic.size() + n_preamble * sizeof(std::uint64_t) +
+               header.size() + n_cols * 3 * sizeof(std::uint64_t);
+    std::vector<std::array<std::uint64_t, 3>> col_table;
+    for (std::size_t i = 0; i < n_cols; ++i) {
+        auto found = tbl.visit_array_data(i, [&](const auto &array_data,
+                                                 auto j) {
+            using T = typename TULA_DECAY(array_data)::value_t;
+            std::size_t size{0};
+            std::size_t elem_size{0};
+            if constexpr (!TULA_DECAY(array_data)::is_eigen_data) {
+                size = (n_rows + 1) * sizeof(std::uint64_t);
+                for (const auto &s : array_data.array()[j]) {
+                    size += s.size();
+                }
+            } else {
+                elem_size = sizeof(T);
+                size = n_rows * elem_size;
+            }
+            pos = internal::align_up(pos);
+            col_table.push_back({pos, size, elem_size});
+            pos += size;
+        });
+        if (!found) {
+            // columns of unsupported types are not loaded to the table
+            col_table.push_back({pos, 0, 0});
+        }
+    }
+    internal::write_atomic(cachepath, [&](std::ofstream &os) {
+        os.write(magic.data(), magic.size());
+        for (std::uint64_t v :
+             {version, key.size, static_cast<std::uint64_t>(key.mtime),
+              key.hash, std::uint64_t(n_rows), std::uint64_t(n_cols),
+              std::uint64_t(header.size()), std::uint64_t(0)}) {
+            internal::write_u64(os, v);
+        }
+        os.write(header.data(), static_cast<std::streamsize>(header.size()));
+        for (const auto &entry : col_table) {
+            for (auto v : entry) {
+                internal::write_u64(os, v);
+            }
+        }
+        auto written = static_cast<std::size_t>(os.tellp());
+        for (std::size_t i = 0; i < n_cols; ++i) {
+            // pad to the block offset
+            std::string pad(col_table[i][0] - written, '\0');
+            os.write(pad.data(), static_cast<std::streamsize>(pad.size()));
+            tbl.visit_array_data(i, [&](const auto &array_data, auto j) {
+                using T = typename TULA_DECAY(array_data)::value_t;
+                if constexpr (!TULA_DECAY(array_data)::is_eigen_data) {
+                    const auto &strs = array_data.array()[j];
+                    std::uint64_t offset{0};
+                    internal::write_u64(os, offset);
+                    for (const auto &s : strs) {
+                        offset += s.size();
+                        internal::write_u64(os, offset);
+                    }
+                    for (const auto &s : strs) {
+                        os.write(s.data(),
+                                 static_cast<std::streamsize>(s.size()));
+                    }
+                } else {
+                    auto [ptr, stride] = array_data.col_data(j);
+                    if (stride == 1) {
+                        os.write(
+                            reinterpret_cast<const char *>(ptr), // NOLINT
+                            static_cast<std::streamsize>(n_rows * sizeof(T)));
+                    } else {
+                        for (std::size_t k = 0; k < n_rows; ++k) {
+                            os.write(reinterpret_cast<const char *>( // NOLINT
+                                         ptr + k * stride),
+                                     sizeof(T));
+                        }
+                    }
+                }
+            });
+            written = col_table[i][0] + col_table[i][1];
+        }
+    });
+}
+
+/// @brief Read table from cache file \p cachepath.
+/// Returns nullopt if the cache does not exist or does not match \p key,
+/// and throws if it is truncated or inconsistent.
+inline auto read(const std::string &cachepath, const Key &key)
+    -> std::optional<ECSVTable> {
+    using traits = ECSVTable::table_data_traits;
+    if (!is_supported || !std::filesystem::exists(cachepath)) {
+        return std::nullopt;
+    }
+    auto file = tula::mmap_utils::MappedFile(cachepath);
+    file.advise(tula::mmap_utils::Advice::sequential);
+    auto buf = file.view();
+    if (buf.size() < magic.size() ||
+        !std::equal(magic.begin(), magic.end(), buf.begin())) {
+        SPDLOG_DEBUG("invalid ECSV cache {}", cachepath);
+        return std::nullopt;
+    }
+    std::size_t pos = magic.size();
+    auto cache_version = internal::read_u64(buf, pos);
+    Key cache_key{};
+    cache_key.size = internal::read_u64(buf, pos);
+    cache_key.mtime = static_cast<std::int64_t>(internal::read_u64(buf, pos));
+    cache_key.hash = internal::read_u64(buf, pos);
+    if (cache_version != version || !(cache_key == key)) {
+        SPDLOG_DEBUG("outdated ECSV cache {}", cachepath);
+        return std::nullopt;
+    }
+    auto n_rows = internal::read_u64(buf, pos);
+    auto n_cols = internal::read_u64(buf, pos);
+    auto header_size = internal::read_u64(buf, pos);
+    internal::read_u64(buf, pos); // reserved
+    auto tbl = ECSVTable(ECSVHeader::read_view(buf.substr(pos, header_size)));
+    pos += header_size;
+    if (tbl.cols() != n_cols) {
+        throw std::runtime_error(
+            fmt::format("inconsistent number of columns in ECSV cache {}",
+                        cachepath));
+    }
+    // each row takes at least one byte in each column
+    if (n_cols > 0 && n_rows > buf.size()) {
+        throw std::runtime_error(fmt::format(
+            "inconsistent number of rows in ECSV cache {}", cachepath));
+    }
+    tbl.resize(n_rows);
+    for (std::size_t i = 0; i < n_cols; ++i) {
+        auto offset = internal::read_u64(buf, pos);
+        auto size = internal::read_u64(buf, pos);
+        auto elem_size = internal::read_u64(buf, pos);
+        if (offset > buf.size() || size > buf.size() - offset) {
+            throw std::runtime_error(
+                fmt::format("truncated ECSV cache {}", cachepath));
+        }
+        auto block = buf.substr(offset, size);
+        traits::visit_dtype(tbl.header().cols()[i].datatype, [&](auto value) {
+            using T = decltype(value);
+            auto colref = tbl.col<T>(i);
+            if constexpr (!ecsv::internal::use_eigen_array_data<T>) {
+                std::size_t p = 0;
+                auto begin = internal::read_u64(block, p);
+                auto bytes =
+                    block.substr((n_rows + 1) * sizeof(std::uint64_t));
+                for (std::size_t k = 0; k < n_rows; ++k) {
+                    auto end = internal::read_u64(block, p);
+                    colref.set_value(k, bytes.substr(begin, end - begin));
+                    begin = end;
+                }
+            } else {
+                if (elem_size != sizeof(T) || size != n_rows * sizeof(T)) {
+                    throw std::runtime_error(fmt::format(
+                        "inconsistent column size in ECSV cache {}",
+                        cachepath));
+                }
+                if (n_rows > 0) {
+                    std::memcpy(&colref(0), block.data(), size);
+                }
+            }
+        });
+    }
+    return tbl;
+}
+
+} // namespace cache
+
+/**
+ * @brief Create table from file, using the binary cache when it is valid.
+ *
+ * On a cache miss the file is parsed with \ref ECSVTable::from_mmap and the
+ * cache is written to \p cachepath, which defaults to the file path with
+ * ".tula_cache" appended. A cache that fails to read is a miss, and failing
+ * to read or write the cache is logged as warning only. On hosts where the
+ * cache is not supported, the file is always parsed.
+ */
+inline auto
+from_mmap_cached(const std::string &filepath,
+                 std::optional<std::string> cachepath = std::nullopt)
+    -> ECSVTable {
+    if constexpr (!cache::is_supported) {
+        return ECSVTable::from_mmap(filepath);
+    }
+    auto path = cachepath.value_or(cache::default_path(filepath));
+    std::string header;
+    {
+        auto file = tula::mmap_utils::MappedFile(filepath);
+        auto buf = file.view();
+        if (internal::is_gzip(buf)) {
+#if TULA_ECSV_HAS_ZLIB
+            // only the blocks up to the end of header are decompressed
+            constexpr std::size_t block_size = 1 << 16;
+            header = ECSVGzipRows(buf, block_size, false).header_text();
+#endif
+        } else {
+            header = buf.substr(0, header_size(buf));
+        }
+    }
+    auto key = cache::make_key(filepath, header);
+    try {
+        if (auto tbl = cache::read(path, key); tbl.has_value()) {
+            SPDLOG_DEBUG("loaded ECSV table from cache {}", path);
+            return std::move(tbl.value());
+        }
+    } catch (const std::exception &e) {
+        // a broken cache is a miss, and is overwritten
+        SPDLOG_WARN("unable to read ECSV cache {}: {}", path, e.what());
+    }
+    auto tbl = ECSVTable::from_mmap(filepath);
+    try {
+        cache::write(tbl, header, key, path);
+    } catch (const std::exception &e) {
+        // the table is valid without the cache
+        SPDLOG_WARN("unable to write ECSV cache {}: {}", path, e.what());
+    }
+    return tbl;
+}
+
+} // namespace tula::ecsv
@@ -3,10 +3,10 @@
 #include "../meta.h"
 #include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <complex>
 #include <map>
 #include <optional>
-#include <regex>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -110,7 +110,6 @@ inline namespace v0 {
 static constexpr std::string_view ECSV_VERSION = "0.9";
 static constexpr char ECSV_DELIM_CHAR = ' ';
 static constexpr std::string_view ECSV_HEADER_PREFIX = "# ";
-static constexpr std::string_view ECSV_VERSION_LINE_REGEX = "^# %ECSV (.+)";
 static constexpr std::string_view ECSV_VERSION_LINE_PREFIX = "%ECSV ";
 static constexpr std::string_view ECSV_META_TAG = "tag:yaml.org,2002:omap";
 
@@ -149,82 +148,175 @@ struct ParseError : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
+/// @brief Throw when a row of the ECSV data section is invalid.
+/// \ref row is the index of the row in the data being parsed, which is
+/// adjusted by the loaders that parse the data in parts.
+struct RowParseError : public ParseError {
+    RowParseError(std::string reason_, std::size_t row_)
+        : ParseError(reason_ + " at row " + std::to_string(row_)),
+          reason{std::move(reason_)}, row{row_} {}
+    std::string reason;
+    std::size_t row;
+};
+
 /// @brief Throw when there is an error when dump ECSV.
 struct DumpError : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
-/// @brief Read stream line by line and parse as ECSV header
-/// @param is Input stream to process.
-/// @param lines Optional output to capture the read lines.
-/// It returns the tuple of the parsed ECSV YAML header node and
-/// The CSV header line.
-template <typename IStream>
-// NOLINTNEXTLINE(readability-function-cognitive-complexity)
-auto parse_header(IStream &is, std::vector<std::string> *lines = nullptr) {
-    std::regex re_ecsv_version{std::string{spec::ECSV_VERSION_LINE_REGEX}};
-
-    std::stringstream ss_header; // stream to hold all header info.
+namespace internal {
 
-    std::size_t li = 0; // running line number
-    std::string ln{};   // running line content
+/**
+ * @brief Collect the ECSV header from lines.
+ *
+ * The YAML lines with the comment prefix removed are appended to one
+ * string, which is parsed once at the end. The same scanner finds the size
+ * of the header in buffers, so that the lines are classified the same way.
+ */
+struct HeaderScanner {
+    std::string yaml{};
     std::string ecsv_spec_version{};
-    std::optional<std::string>
-        csv_header{}; // csv header, immediately after the ECSV header
-    while (std::getline(is, ln)) {
-        // SPDLOG_TRACE("current line: {}", ln);
-        if (lines) {
-            lines->push_back(ln);
+    /// @brief The CSV header, immediately after the ECSV header.
+    std::optional<std::string> csv_header{};
+    /// @brief The running line number.
+    std::size_t li{0};
+    /// @brief The size of the lines added with \ref add_lines.
+    std::size_t size{0};
+    /// @brief If false, the YAML lines are not collected, which is for
+    /// finding the size of the header only.
+    bool collect_yaml{true};
+
+    /// @brief Add line \p ln. Returns false when it is the CSV header.
+    auto add_line(std::string_view ln) -> bool {
+        // ignore any leading spaces and the CR of CRLF line ending
+        auto pos = std::find_if(ln.begin(), ln.end(), [](auto ch) {
+            return !std::isspace(static_cast<unsigned char>(ch));
+        });
+        ln.remove_prefix(static_cast<std::size_t>(pos - ln.begin()));
+        if (!ln.empty() && ln.back() == '\r') {
+            ln.remove_suffix(1);
         }
-        // ignore any leading spaces
-        ln.erase(ln.begin(), std::find_if(ln.begin(), ln.end(), [](auto ch) {
-                     return !std::isspace(ch);
-                 }));
+        ++li;
         // check first line.
-        if (li == 0) {
-            std::smatch sm;
-            if (std::regex_match(ln, sm, re_ecsv_version)) {
-                // update the version number
-                ecsv_spec_version = sm[1];
-            } else {
+        if (li == 1) {
+            constexpr auto prefix = spec::ECSV_HEADER_PREFIX;
+            constexpr auto version_prefix = spec::ECSV_VERSION_LINE_PREFIX;
+            if (!startswith(ln, prefix) ||
+                !startswith(ln.substr(prefix.size()), version_prefix)) {
                 throw ParseError("no ECSV version line found");
             }
-            ++li;
-            continue;
+            // any version text is accepted, without the trailing spaces
+            auto version = ln.substr(prefix.size() + version_prefix.size());
+            auto last = version.find_last_not_of(" \t");
+            version = version.substr(
+                0, last == std::string_view::npos ? 0 : last + 1);
+            if (version.empty()) {
+                throw ParseError("no ECSV version found in version line");
+            }
+            // update the version number
+            ecsv_spec_version = version;
+            return true;
         }
-        // l > 0
         if (ln == "#") {
             // this is an empty line, just ignore
-            ++li;
-            continue;
+            return true;
         }
-        if (internal::startswith(ln, spec::ECSV_HEADER_PREFIX)) {
+        if (startswith(ln, spec::ECSV_HEADER_PREFIX)) {
             // this line is part of the header yaml
-            // put the actual yaml part to the stream
-            for (auto it = ln.begin() + spec::ECSV_HEADER_PREFIX.size();
-                 it != ln.end(); ++it) {
-                ss_header << *it;
+            if (collect_yaml) {
+                yaml.append(ln.substr(spec::ECSV_HEADER_PREFIX.size()));
+                yaml.push_back('\n');
             }
-            ss_header << "\n";
-            ++li;
-            continue;
+            return true;
         }
-        // else
         // this line is not the yaml header and is expect to be the csv header
-        {
-            csv_header = ln;
-            ++li;
+        csv_header = ln;
+        return false;
+    }
+
+    /// @brief Add the lines of \p buf from offset \ref size, until the CSV
+    /// header. Returns true if the CSV header is found. The last line without
+    /// line ending is added only if \p at_end is true, so \p buf can be the
+    /// start of the content that is read in parts, with the same start on
+    /// each call.
+    auto add_lines(std::string_view buf, bool at_end = true) -> bool {
+        while (size < buf.size()) {
+            auto eol = buf.find('\n', size);
+            if (eol == std::string_view::npos && !at_end) {
+                return false;
+            }
+            auto next = (eol == std::string_view::npos) ? buf.size() : eol + 1;
+            auto ln = buf.substr(size, next - size);
+            if (eol != std::string_view::npos) {
+                ln.remove_suffix(1);
+            }
+            size = next;
+            if (!add_line(ln)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Return the tuple of the parsed YAML node and the CSV header.
+    auto finish() {
+        auto node = YAML::Load(yaml);
+        // we update some additional info in to the node for internal usage
+        node["_ecsv_spec_version"] = ecsv_spec_version;
+        return std::tuple{node, std::move(csv_header)};
+    }
+};
+
+} // namespace internal
+
+/// @brief Read stream line by line and parse as ECSV header
+/// @param is Input stream to process.
+/// @param lines Optional output to capture the read lines.
+/// It returns the tuple of the parsed ECSV YAML header node and
+/// The CSV header line.
+template <typename IStream>
+auto parse_header(IStream &is, std::vector<std::string> *lines = nullptr) {
+    internal::HeaderScanner scanner{};
+    std::string ln{}; // running line content
+    while (std::getline(is, ln)) {
+        // SPDLOG_TRACE("current line: {}", ln);
+        if (lines) {
+            lines->push_back(ln);
+        }
+        if (!scanner.add_line(ln)) {
             break;
         }
     }
-    assert(lines ? (li == lines->size()) : true); // sanity check
-    // Create yaml node
-    auto node = YAML::Load(ss_header);
-    // we update some additional info in to the node for internal usage
-    node["_ecsv_spec_version"] = ecsv_spec_version;
-    return std::tuple{node, csv_header};
+    assert(lines ? (scanner.li == lines->size()) : true); // sanity check
+    return scanner.finish();
 };
 
+/// @brief Parse ECSV header at the start of contiguous buffer \p buf.
+/// This is the same as \ref parse_header, with the lines as views into
+/// \p buf.
+/// @param size Optional output of the size of the header, including the
+/// CSV header line. The data section starts at this offset.
+inline auto parse_header_view(std::string_view buf,
+                              std::size_t *size = nullptr) {
+    internal::HeaderScanner scanner{};
+    scanner.add_lines(buf);
+    if (size) {
+        *size = scanner.size;
+    }
+    return scanner.finish();
+}
+
+/// @brief Return the size of the ECSV header at the start of \p buf.
+/// The size includes the CSV header line, so the data section starts at
+/// the returned offset. The lines are classified the same way as in
+/// \ref parse_header, but the YAML is not parsed.
+inline auto header_size(std::string_view buf) -> std::size_t {
+    internal::HeaderScanner scanner{};
+    scanner.collect_yaml = false;
+    scanner.add_lines(buf);
+    return scanner.size;
+}
+
 template <typename T>
 auto dtype_str() -> std::string {
     // bool, int8, int16, int32, int64
@@ -261,7 +353,8 @@ auto dtype_str() -> std::string {
         return "complex128";
     } else if constexpr (std::is_same_v<T, std::complex<long double>>) {
         return "complex256";
-    } else if constexpr (std::is_same_v<T, std::string>) {
+    } else if constexpr (std::is_same_v<T, std::string> ||
+                         std::is_same_v<T, std::string_view>) {
         return "string";
     } else {
         static_assert(tula::meta::always_false<T>,
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "../meta.h"
+#include <cerrno>
+#include <charconv>
+#include <complex>
+#include <cstdlib>
+#include <limits>
+#include <locale.h>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#if __has_include(<xlocale.h>)
+#include <xlocale.h>
+#endif
+
+namespace tula::ecsv {
+
+namespace internal {
+
+/// @brief Return \p s with leading and trailing spaces removed.
+constexpr auto strip_field(std::string_view s) noexcept -> std::string_view {
+    constexpr std::string_view ws = " \t\r\n";
+    auto first = s.find_first_not_of(ws);
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    auto last = s.find_last_not_of(ws);
+    return s.substr(first, last - first + 1);
+}
+
+/// @brief Return the value to use when a field cannot be decoded.
+template <typename T>
+constexpr auto missing_value() noexcept -> T {
+    if constexpr (std::is_floating_point_v<T>) {
+        return std::numeric_limits<T>::quiet_NaN();
+    } else if constexpr (tula::meta::is_instance<T, std::complex>::value) {
+        using real_t = typename T::value_type;
+        return {missing_value<real_t>(), missing_value<real_t>()};
+    } else {
+        return T{};
+    }
+}
+
+/// @brief Remove the leading '+' of \p s, which std::from_chars does not
+/// accept. Returns false if another sign follows.
+constexpr auto remove_plus_sign(std::string_view &s) noexcept -> bool {
+    if (!s.empty() && s.front() == '+') {
+        s.remove_prefix(1);
+        return s.empty() || (s.front() != '+' && s.front() != '-');
+    }
+    return true;
+}
+
+/// @brief True if std::from_chars is available for floating point \p T.
+/// libc++ has it for float and double since LLVM 20, and not for long
+/// double.
+template <typename T>
+inline constexpr bool has_from_chars_floating_v =
+#if defined(_LIBCPP_VERSION)
+    _LIBCPP_VERSION >= 200000 && !std::is_same_v<T, long double>;
+#elif defined(__cpp_lib_to_chars)
+    true;
+#else
+    false;
+#endif
+
+/// @brief Return the C locale for the strto*_l functions.
+inline auto c_locale() noexcept -> locale_t {
+    static const locale_t loc = ::newlocale(LC_ALL_MASK, "C", nullptr);
+    return loc;
+}
+
+/// @brief Decode integral number with std::from_chars.
+template <tula::meta::Integral T>
+auto decode_integral(std::string_view s, T &value) noexcept -> bool {
+    if (!remove_plus_sign(s)) {
+        return false;
+    }
+    const auto *end = s.data() + s.size();
+    auto [ptr, ec] = std::from_chars(s.data(), end, value);
+    return (ec == std::errc{}) && (ptr == end);
+}
+
+/// @brief Decode floating point number with std::from_chars, which does
+/// not depend on the locale.
+/// Where std::from_chars is not available for \p T, the strto*_l functions
+/// with the C locale are used on a small stack buffer, with the hex floats
+/// and the spaces they would take rejected beforehand.
+template <typename T>
+requires std::is_floating_point_v<T>
+auto decode_floating(std::string_view s, T &value) noexcept -> bool {
+    if (!remove_plus_sign(s)) {
+        return false;
+    }
+    if constexpr (has_from_chars_floating_v<T>) {
+        const auto *end = s.data() + s.size();
+        auto [ptr, ec] = std::from_chars(s.data(), end, value);
+        return (ec == std::errc{}) && (ptr == end);
+    } else {
+        constexpr std::size_t buf_size = 64;
+        if (s.empty() || s.size() >= buf_size ||
+            s.find_first_of("xX \t\n\v\f\r") != std::string_view::npos) {
+            return false;
+        }
+        char buf[buf_size]; // NOLINT(modernize-avoid-c-arrays)
+        s.copy(buf, s.size());
+        buf[s.size()] = '\0';
+        char *end{nullptr};
+        errno = 0;
+        if constexpr (std::is_same_v<T, float>) {
+            value = ::strtof_l(buf, &end, c_locale());
+        } else if constexpr (std::is_same_v<T, double>) {
+            value = ::strtod_l(buf, &end, c_locale());
+        } else {
+            value = ::strtold_l(buf, &end, c_locale());
+        }
+        // out of range is an error, as with std::from_chars
+        return (errno != ERANGE) && (end == buf + s.size());
+    }
+}
+
+/// @brief Decode boolean.
+/// Accept True/False (as written by astropy), true/false and 1/0.
+inline auto decode_bool(std::string_view s, bool &value) noexcept -> bool {
+    if (s == "True" || s == "true" || s == "1") {
+        value = true;
+        return true;
+    }
+    if (s == "False" || s == "false" || s == "0") {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Decode complex number.
+/// Accept the C++ stream form "(re,im)", the python form "(re+imj)" or
+/// "re+imj", and a plain real number.
+template <typename T>
+auto decode_complex(std::string_view s, std::complex<T> &value) noexcept
+    -> bool {
+    if (s.size() >= 2 && s.front() == '(' && s.back() == ')') {
+        s = strip_field(s.substr(1, s.size() - 2));
+    }
+    T re{0};
+    T im{0};
+    if (auto pos = s.find(','); pos != std::string_view::npos) {
+        if (!(decode_floating(strip_field(s.substr(0, pos)), re) &&
+              decode_floating(strip_field(s.substr(pos + 1)), im))) {
+            return false;
+        }
+    } else if (!s.empty() && (s.back() == 'j' || s.back() == 'J')) {
+        s.remove_suffix(1);
+        // locate the sign that separates the real and imaginary parts,
+        // skipping the leading sign and the ones in exponents.
+        auto pos = s.size();
+        for (auto i = s.size(); i-- > 1;) {
+            if ((s[i] == '+' || s[i] == '-') && s[i - 1] != 'e' &&
+                s[i - 1] != 'E') {
+                pos = i;
+                break;
+            }
+        }
+        if (pos == s.size()) {
+            // pure imaginary
+            if (!decode_floating(s, im)) {
+                return false;
+            }
+        } else if (!(decode_floating(s.substr(0, pos), re) &&
+                     decode_floating(s.substr(pos), im))) {
+            return false;
+        }
+    } else if (!decode_floating(s, re)) {
+        return false;
+    }
+    value = {re, im};
+    return true;
+}
+
+} // namespace internal
+
+/**
+ * @brief Decode ECSV field text \p s to \p value.
+ *
+ * Surrounding spaces are ignored. When the text cannot be decoded, \p value
+ * is set to the missing value of the type (NaN for floating point, zero
+ * otherwise) and false is returned. No stream, locale or heap allocation
+ * is involved except for assigning to string.
+ */
+template <typename T>
+auto decode_field(std::string_view s, T &value) -> bool {
+    if constexpr (tula::meta::String<T>) {
+        value.assign(s.data(), s.size());
+        return true;
+    } else {
+        s = internal::strip_field(s);
+        bool ok{false};
+        if constexpr (std::is_same_v<T, bool>) {
+            ok = internal::decode_bool(s, value);
+        } else if constexpr (tula::meta::Integral<T>) {
+            ok = internal::decode_integral(s, value);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            ok = internal::decode_floating(s, value);
+        } else if constexpr (tula::meta::is_instance<T, std::complex>::value) {
+            ok = internal::decode_complex(s, value);
+        } else {
+            static_assert(tula::meta::always_false<T>,
+                          "TULA ECSV IS NOT IMPLEMENTED FOR THIS SCALAR TYPE");
+        }
+        if (!ok) {
+            value = internal::missing_value<T>();
+        }
+        return ok;
+    }
+}
+
+/// @brief The type-erased field decoder that writes to \p dest.
+using field_decoder_t = bool (*)(std::string_view, void *);
+
+/// @brief Return the type-erased field decoder for type \p T.
+template <typename T>
+constexpr auto field_decoder() noexcept -> field_decoder_t {
+    return [](std::string_view s, void *dest) -> bool {
+        return decode_field(s, *static_cast<T *>(dest));
+    };
+}
+
+} // namespace tula::ecsv
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../meta.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <complex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace tula::ecsv {
+
+namespace internal {
+
+/// @brief The size of the stack buffer to format a number to.
+constexpr std::size_t encode_buf_size = 128;
+
+/// @brief Append number \p value to \p out with std::to_chars.
+/// Floating point numbers are written in the shortest form that round-trips.
+template <typename T>
+void encode_number(std::string &out, T value) {
+    std::array<char, encode_buf_size> buf{};
+    auto [ptr, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    out.append(buf.data(), ptr);
+}
+
+/// @brief Append complex number in the python form "(re+imj)".
+template <typename T>
+void encode_complex(std::string &out, const std::complex<T> &value) {
+    out.push_back('(');
+    encode_number(out, value.real());
+    if (!std::signbit(value.imag())) {
+        out.push_back('+');
+    }
+    encode_number(out, value.imag());
+    out.append("j)");
+}
+
+/// @brief Append string, quoted if it is empty or contains delimiter,
+/// space, newline or quote chars.
+inline void encode_string(std::string &out, std::string_view s) {
+    constexpr char quote = '"';
+    constexpr std::string_view special = " ,\t\r\n\"";
+    if (!s.empty() && s.find_first_of(special) == std::string_view::npos) {
+        out.append(s);
+        return;
+    }
+    out.push_back(quote);
+    for (auto c : s) {
+        if (c == quote) {
+            out.push_back(quote);
+        }
+        out.push_back(c);
+    }
+    out.push_back(quote);
+}
+
+} // namespace internal
+
+/**
+ * @brief Encode \p value as ECSV field text and append to \p out.
+ *
+ * This is the inverse of \ref decode_field. Numbers are written with
+ * std::to_chars, bools as True/False, and complex numbers as "(re+imj)".
+ * Strings are quoted when needed.
+ */
+template <typename T>
+void encode_field(std::string &out, const T &value) {
+    if constexpr (tula::meta::String<T> || tula::meta::StringView<T>) {
+        internal::encode_string(out, value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        out.append(value ? "True" : "False");
+    } else if constexpr (tula::meta::Integral<T> ||
+                         std::is_floating_point_v<T>) {
+        internal::encode_number(out, value);
+    } else if constexpr (tula::meta::is_instance<T, std::complex>::value) {
+        internal::encode_complex(out, value);
+    } else {
+        static_assert(tula::meta::always_false<T>,
+                      "TULA ECSV IS NOT IMPLEMENTED FOR THIS SCALAR TYPE");
+    }
+}
+
+/// @brief The type-erased field encoder that reads from \p src.
+using field_encoder_t = void (*)(std::string &, const void *);
+
+/// @brief Return the type-erased field encoder for type \p T.
+template <typename T>
+constexpr auto field_encoder() noexcept -> field_encoder_t {
+    return [](std::string &out, const void *src) {
+        encode_field(out, *static_cast<const T *>(src));
+    };
+}
+
+} // namespace tula::ecsv
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "decoder.h"
+#include "hdr.h"
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace tula::ecsv {
+
+/**
+ * @brief Row predicate over a few key columns, to select the rows to load.
+ *
+ * The key fields of each row are decoded to \p Keys and passed to the
+ * predicate. The other columns are decoded and stored only for the rows
+ * that are kept, so with a selective predicate the loading cost is close
+ * to that of the output.
+ *
+ * @see \ref row_filter, \ref BasicECSVTable::load_rows.
+ */
+template <typename Pred, typename... Keys>
+struct ECSVRowFilter {
+    constexpr static std::size_t n_keys = sizeof...(Keys);
+    using keys_t = std::array<std::string, n_keys>;
+
+    ECSVRowFilter(keys_t keys_, Pred pred_)
+        : keys{std::move(keys_)}, pred{std::move(pred_)} {}
+
+    keys_t keys;
+    Pred pred;
+
+    /// @brief Return the callable that tests the fields of rows of
+    /// \p hdr. Throws if a key column is missing or of other type.
+    auto bind(const ECSVHeader &hdr) const {
+        std::array<std::size_t, n_keys> field_idx{};
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (..., (field_idx[I] = key_index<Keys>(hdr, keys[I])));
+        }(std::index_sequence_for<Keys...>{});
+        return [this, field_idx](const auto &fields) -> bool {
+            return [&]<std::size_t... I>(std::index_sequence<I...>) {
+                std::tuple<Keys...> values{};
+                (..., decode_field(fields[field_idx[I]], std::get<I>(values)));
+                return std::apply(pred, values);
+            }(std::index_sequence_for<Keys...>{});
+        };
+    }
+
+private:
+    template <typename T>
+    static auto key_index(const ECSVHeader &hdr, const std::string &name)
+        -> std::size_t {
+        const auto &cols = hdr.cols();
+        for (std::size_t i = 0; i < cols.size(); ++i) {
+            if (cols[i].name != name) {
+                continue;
+            }
+            if (cols[i].datatype != dtype_str<T>()) {
+                throw std::runtime_error(
+                    fmt::format("filter key {} of type {} is not of type {}",
+                                name, cols[i].datatype, dtype_str<T>()));
+            }
+            return i;
+        }
+        throw std::runtime_error(
+            fmt::format("filter key {} is not in the header", name));
+    }
+};
+
+/// @brief Create row filter of \p pred over the key columns \p keys of
+/// types \p Keys, e.g.,
+/// `row_filter<int64_t>({"flag"}, [](auto flag) { return flag == 0; })`.
+template <typename... Keys, typename Pred>
+auto row_filter(std::array<std::string, sizeof...(Keys)> keys, Pred &&pred)
+    -> ECSVRowFilter<std::decay_t<Pred>, Keys...> {
+    return {std::move(keys), std::forward<Pred>(pred)};
+}
+
+/// @brief True if \p T is a \ref ECSVRowFilter.
+template <typename T>
+concept RowFilter = requires(const T &filter, const ECSVHeader &hdr) {
+    T::n_keys;
+    filter.bind(hdr);
+};
+
+} // namespace tula::ecsv
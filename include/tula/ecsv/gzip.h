@@ -0,0 +1,421 @@
+#pragma once
+
+#include "core.h"
+#include "hdr.h"
+#include "tokenizer.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+// zlib is enabled explicitly, e.g., with the CMake option TULA_WITH_ZLIB,
+// because the user code has to link it.
+#ifndef TULA_ECSV_HAS_ZLIB
+#define TULA_ECSV_HAS_ZLIB 0
+#endif
+#if TULA_ECSV_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace tula::ecsv {
+
+namespace internal {
+
+/// @brief Return true if \p buf starts with the gzip magic bytes.
+inline auto is_gzip(std::string_view buf) noexcept -> bool {
+    return buf.size() >= 2 && static_cast<std::uint8_t>(buf[0]) == 0x1f &&
+           static_cast<std::uint8_t>(buf[1]) == 0x8b;
+}
+
+} // namespace internal
+
+/// @brief True if reading gzip-compressed ECSV data is supported.
+/// This requires zlib, which is enabled by defining TULA_ECSV_HAS_ZLIB=1
+/// and linking zlib.
+constexpr bool gzip_is_supported = TULA_ECSV_HAS_ZLIB;
+
+#if TULA_ECSV_HAS_ZLIB
+
+/**
+ * @brief Decompress gzip or zlib data held in memory.
+ *
+ * Concatenated gzip members, as produced by e.g. `cat a.gz b.gz`, are
+ * decompressed as one stream.
+ */
+struct GzipDecoder {
+    explicit GzipDecoder(std::string_view src) : m_src{src} {
+        // 32 to detect the gzip or zlib header
+        constexpr int window_bits = 15 + 32;
+        if (inflateInit2(&m_strm, window_bits) != Z_OK) {
+            throw std::runtime_error("unable to initialize zlib inflate");
+        }
+    }
+    GzipDecoder(const GzipDecoder &) = delete;
+    GzipDecoder(GzipDecoder &&) = delete;
+    auto operator=(const GzipDecoder &) -> GzipDecoder & = delete;
+    auto operator=(GzipDecoder &&) -> GzipDecoder & = delete;
+    ~GzipDecoder() { inflateEnd(&m_strm); }
+
+    /// @brief Decompress up to \p size bytes to \p out.
+    /// Returns the number of bytes written, which is less than \p size only
+    /// at the end of the data.
+    auto read(char *out, std::size_t size) -> std::size_t {
+        constexpr std::size_t max_avail = std::numeric_limits<uInt>::max();
+        std::size_t n = 0;
+        while (n < size && !m_done) {
+            if (m_strm.avail_in == 0) {
+                if (m_pos == m_src.size()) {
+                    if (m_in_member) {
+                        throw ParseError("truncated gzip data");
+                    }
+                    m_done = true;
+                    break;
+                }
+                auto n_in = std::min(m_src.size() - m_pos, max_avail);
+                // NOLINTNEXTLINE
+                m_strm.next_in = reinterpret_cast<Bytef *>(
+                    const_cast<char *>(m_src.data() + m_pos));
+                m_strm.avail_in = static_cast<uInt>(n_in);
+                m_pos += n_in;
+                m_in_member = true;
+            }
+            auto n_out = std::min(size - n, max_avail);
+            m_strm.next_out = reinterpret_cast<Bytef *>(out + n); // NOLINT
+            m_strm.avail_out = static_cast<uInt>(n_out);
+            auto ret = inflate(&m_strm, Z_NO_FLUSH);
+            n += n_out - m_strm.avail_out;
+            if (ret == Z_STREAM_END) {
+                m_in_member = false;
+                if (m_strm.avail_in == 0 && m_pos == m_src.size()) {
+                    m_done = true;
+                } else {
+                    inflateReset(&m_strm);
+                }
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw ParseError(fmt::format(
+                    "invalid gzip data: {}",
+                    m_strm.msg == nullptr ? "unknown error" : m_strm.msg));
+            }
+        }
+        return n;
+    }
+
+private:
+    std::string_view m_src;
+    std::size_t m_pos{0};
+    z_stream m_strm{};
+    bool m_in_member{false};
+    bool m_done{false};
+};
+
+/**
+ * @brief Decompress gzip data in blocks.
+ *
+ * When threaded, the blocks are decompressed on a background thread ahead
+ * of the consumer, up to \ref max_queued blocks, so the decompression is
+ * overlapped with the parsing of the previous blocks. The block buffers
+ * are recycled between the threads.
+ */
+struct GzipBlockReader {
+    constexpr static std::size_t default_block_size = 1 << 22;
+    constexpr static std::size_t max_queued = 2;
+
+    explicit GzipBlockReader(std::string_view src,
+                             std::size_t block_size = default_block_size,
+                             bool threaded = true)
+        : m_decoder{src}, m_block_size{std::max<std::size_t>(block_size, 1)} {
+        if (threaded) {
+            m_thread = std::thread([this]() { produce(); });
+        }
+    }
+    GzipBlockReader(const GzipBlockReader &) = delete;
+    GzipBlockReader(GzipBlockReader &&) = delete;
+    auto operator=(const GzipBlockReader &) -> GzipBlockReader & = delete;
+    auto operator=(GzipBlockReader &&) -> GzipBlockReader & = delete;
+    ~GzipBlockReader() {
+        if (m_thread.joinable()) {
+            {
+                std::scoped_lock lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            m_thread.join();
+        }
+    }
+
+    /// @brief Read the next block to \p block.
+    /// Returns false if no more data. The previous buffer of \p block is
+    /// reused for later blocks.
+    auto next(std::string &block) -> bool {
+        if (!m_thread.joinable()) {
+            block.resize(m_block_size);
+            block.resize(m_decoder.read(block.data(), m_block_size));
+            return !block.empty();
+        }
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] {
+            return !m_queue.empty() || m_done || m_error;
+        });
+        if (m_queue.empty()) {
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+            block.clear();
+            return false;
+        }
+        m_free.push_back(std::move(block));
+        block = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_cv.notify_all();
+        return true;
+    }
+
+private:
+    GzipDecoder m_decoder;
+    std::size_t m_block_size;
+    std::thread m_thread{};
+    std::mutex m_mutex{};
+    std::condition_variable m_cv{};
+    std::deque<std::string> m_queue{};
+    std::vector<std::string> m_free{};
+    std::exception_ptr m_error{};
+    bool m_done{false};
+    bool m_stop{false};
+
+    void produce() {
+        try {
+            while (true) {
+                std::string buf;
+                {
+                    std::scoped_lock lock(m_mutex);
+                    if (!m_free.empty()) {
+                        buf = std::move(m_free.back());
+                        m_free.pop_back();
+                    }
+                }
+                buf.resize(m_block_size);
+                buf.resize(m_decoder.read(buf.data(), m_block_size));
+                std::unique_lock lock(m_mutex);
+                m_cv.wait(lock, [this] {
+                    return m_queue.size() < max_queued || m_stop;
+                });
+                if (m_stop) {
+                    return;
+                }
+                if (buf.empty()) {
+                    m_done = true;
+                } else {
+                    m_queue.push_back(std::move(buf));
+                }
+                lock.unlock();
+                m_cv.notify_all();
+                if (m_done) {
+                    return;
+                }
+            }
+        } catch (...) {
+            {
+                std::scoped_lock lock(m_mutex);
+                m_error = std::current_exception();
+            }
+            m_cv.notify_all();
+        }
+    }
+};
+
+/**
+ * @brief Read the rows of gzip-compressed ECSV data.
+ *
+ * The header is read on construction. The data are decompressed in blocks
+ * with \ref GzipBlockReader, and the whole rows in each block are split to
+ * fields with \ref ECSVTokenizer, while the partial row at the end is
+ * carried over to the next block. This is a single-pass range of the
+ * fields of the rows, as \ref ECSVTokenizer.
+ */
+struct ECSVGzipRows {
+    using fields_t = ECSVTokenizer::fields_t;
+
+    explicit ECSVGzipRows(
+        std::string_view src,
+        std::size_t block_size = GzipBlockReader::default_block_size,
+        bool threaded = true)
+        : m_reader{src, block_size, threaded} {
+        // read blocks until the CSV header line is complete, with the
+        // lines of each block added to the scanner once
+        internal::HeaderScanner scanner{};
+        bool more = true;
+        while (more) {
+            more = m_reader.next(m_block);
+            m_buf.append(m_block);
+            if (scanner.add_lines(m_buf, !more)) {
+                break;
+            }
+        }
+        auto data_offset = scanner.size;
+        m_header_text = m_buf.substr(0, data_offset);
+        m_hdr.emplace(std::apply(ECSVHeader::from_node, scanner.finish()));
+        m_buf.erase(0, data_offset);
+        m_eof = !more;
+        split_rows();
+    }
+    ECSVGzipRows(const ECSVGzipRows &) = delete;
+    ECSVGzipRows(ECSVGzipRows &&) = delete;
+    auto operator=(const ECSVGzipRows &) -> ECSVGzipRows & = delete;
+    auto operator=(ECSVGzipRows &&) -> ECSVGzipRows & = delete;
+    ~ECSVGzipRows() = default;
+
+    auto header() const -> const ECSVHeader & { return m_hdr.value(); }
+    /// @brief The decompressed header text, including the CSV header line.
+    auto header_text() const noexcept -> std::string_view {
+        return m_header_text;
+    }
+
+    /// @brief Read the next row to \p fields. Returns false if no more rows.
+    auto next(fields_t &fields) -> bool {
+        while (!m_rows->next(fields)) {
+            if (m_eof && m_tail.empty()) {
+                return false;
+            }
+            refill();
+        }
+        return true;
+    }
+
+    struct iterator {
+        ECSVGzipRows *rows{nullptr};
+        fields_t fields{};
+        bool done{true};
+
+        auto operator*() const noexcept -> const fields_t & { return fields; }
+        auto operator->() const noexcept -> const fields_t * {
+            return &fields;
+        }
+        auto operator++() -> iterator & {
+            done = !rows->next(fields);
+            return *this;
+        }
+        auto operator==(const iterator &other) const noexcept -> bool {
+            return done == other.done;
+        }
+    };
+    auto begin() -> iterator {
+        iterator it{this};
+        ++it;
+        return it;
+    }
+    auto end() -> iterator { return iterator{this}; }
+
+private:
+    GzipBlockReader m_reader;
+    std::optional<ECSVHeader> m_hdr{};
+    std::string m_header_text{};
+    std::string m_block{};
+    /// @brief The whole rows being tokenized.
+    std::string m_buf{};
+    /// @brief The partial row after m_buf.
+    std::string m_tail{};
+    /// @brief The quote state at the end of the last scan for row end.
+    bool m_scan_in_quote{false};
+    bool m_eof{false};
+    std::optional<ECSVTokenizer> m_rows{};
+
+    /// @brief Move the partial row at the end of m_buf to m_tail, and
+    /// tokenize the rest.
+    void split_rows() {
+        m_tail.clear();
+        if (!m_eof) {
+            auto end = find_row_end(m_buf, 0);
+            auto begin = (end == std::string::npos) ? 0 : end + 1;
+            m_tail.assign(m_buf, begin);
+            m_buf.resize(begin);
+        }
+        m_rows.emplace(m_buf, m_hdr->delimiter());
+    }
+
+    /// @brief Read blocks until there are whole rows, and tokenize them.
+    void refill() {
+        m_buf.swap(m_tail);
+        m_tail.clear();
+        auto scan_pos = std::size_t{0};
+        while (!m_eof) {
+            if (!m_reader.next(m_block)) {
+                m_eof = true;
+                break;
+            }
+            m_buf.append(m_block);
+            auto end = find_row_end(m_buf, scan_pos);
+            if (end != std::string::npos) {
+                m_tail.assign(m_buf, end + 1);
+                m_buf.resize(end + 1);
+                break;
+            }
+            // a row longer than the block
+            scan_pos = m_buf.size();
+        }
+        m_rows.emplace(m_buf, m_hdr->delimiter());
+    }
+
+    /// @brief Return the position of the last newline not in quoted field
+    /// in \p buf, scanning from \p pos with the quote state kept from the
+    /// previous scan.
+    auto find_row_end(std::string_view buf, std::size_t pos)
+        -> std::size_t {
+        constexpr auto quote = ECSVTokenizer::quote_char;
+        auto end = std::string::npos;
+        if (pos == 0) {
+            m_scan_in_quote = false;
+        }
+        auto tail = buf.substr(pos);
+        if (!m_scan_in_quote &&
+            tail.find(quote) == std::string_view::npos) {
+            auto eol = tail.rfind('\n');
+            return eol == std::string_view::npos ? end : pos + eol;
+        }
+        for (auto i = pos; i < buf.size(); ++i) {
+            if (buf[i] == quote) {
+                m_scan_in_quote = !m_scan_in_quote;
+            } else if (buf[i] == '\n' && !m_scan_in_quote) {
+                end = i;
+            }
+        }
+        return end;
+    }
+};
+
+#endif
+
+namespace internal {
+
+/// @brief Throw the error that gzip-compressed \p filepath cannot be read,
+/// for \p reason.
+[[noreturn]] inline void throw_gzip_unsupported(const std::string &filepath,
+                                                std::string_view reason) {
+    throw std::runtime_error(fmt::format(
+        "unable to read gzip-compressed {} {}", filepath, reason));
+}
+
+/// @brief Return the header of ECSV file \p filepath of content \p buf.
+/// For gzip-compressed files, only the blocks up to the end of the header
+/// are decompressed.
+inline auto read_file_header(std::string_view buf,
+                             [[maybe_unused]] const std::string &filepath)
+    -> ECSVHeader {
+    if (!is_gzip(buf)) {
+        return ECSVHeader::read_view(buf);
+    }
+#if TULA_ECSV_HAS_ZLIB
+    constexpr std::size_t block_size = 1 << 16;
+    return ECSVGzipRows(buf, block_size, false).header();
+#else
+    throw_gzip_unsupported(filepath, "without zlib");
+#endif
+}
+
+} // namespace internal
+
+} // namespace tula::ecsv
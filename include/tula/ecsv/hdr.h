@@ -2,6 +2,7 @@
 
 #include "../formatter/utils.h"
 #include "core.h"
+#include <algorithm>
 #include <fmt/core.h>
 #include <ranges>
 
@@ -80,26 +81,44 @@ struct ECSVHeader {
         // when csv_header is provided, we can check the csv header for
         // consistency
         if (csv_header.has_value()) {
-            // break the line to get colnames
+            // break the line to get colnames. The colnames can be quoted,
+            // with the quote chars in them doubled.
+            constexpr char quote = '"';
             std::vector<std::string> csv_colnames{};
             std::string colname{};
-            for (char &it : csv_header.value()) {
-                if (delimiter != it) {
+            bool in_colname{false};
+            bool in_quote{false};
+            const auto &ln = csv_header.value();
+            for (std::size_t i = 0; i < ln.size(); ++i) {
+                auto it = ln[i];
+                if (it == quote) {
+                    if (in_quote && i + 1 < ln.size() && ln[i + 1] == quote) {
+                        colname += quote;
+                        ++i;
+                    } else {
+                        in_quote = !in_quote;
+                    }
+                    in_colname = true;
+                    continue;
+                }
+                if (in_quote || delimiter != it) {
                     // not a delim, so append to colname
                     colname += it;
+                    in_colname = true;
                     continue;
                 }
                 // found delim
-                if (colname.empty()) {
+                if (!in_colname) {
                     // keep finding if nothing in colname
                     continue;
                 }
                 // got something in colname
                 csv_colnames.push_back(colname);
                 colname.clear(); // reset for the next
+                in_colname = false;
             }
             // get anything left in colname
-            if (!colname.empty()) {
+            if (in_colname) {
                 csv_colnames.push_back(colname);
             }
             // check the size of colnames with ecsv header cols
@@ -123,12 +142,63 @@ struct ECSVHeader {
                           std::move(spec_version));
     }
 
+    /// @brief Return the YAML node of the header.
+    /// This is the inverse of \ref from_node.
+    auto to_node() const -> YAML::Node {
+        YAML::Node node;
+        node.SetStyle(YAML::EmitterStyle::Block);
+        if (m_delimiter != spec::ECSV_DELIM_CHAR) {
+            node[spec::k_delimiter.data()] = std::string(1, m_delimiter);
+        }
+        for (const auto &col : m_cols) {
+            YAML::Node n;
+            n.SetStyle(YAML::EmitterStyle::Flow);
+            n[spec::k_name.data()] = col.name;
+            n[spec::k_datatype.data()] = col.datatype;
+            auto set_optional = [&n](std::string_view key,
+                                     const std::optional<std::string> &v) {
+                if (v.has_value()) {
+                    n[key.data()] = v.value();
+                }
+            };
+            set_optional(spec::k_subtype, col.subtype);
+            set_optional(spec::k_unit, col.unit);
+            set_optional(spec::k_format, col.format);
+            set_optional(spec::k_description, col.description);
+            node[spec::k_datatype.data()].push_back(n);
+        }
+        if (!m_meta.IsNull()) {
+            node[spec::k_meta.data()] = m_meta;
+        }
+        if (m_schema.has_value()) {
+            node[spec::k_schema.data()] = m_schema.value();
+        }
+        return node;
+    }
+
     /// @brief Create ECSV header from stream
+    /// Gzip-compressed streams are not supported, because the rows could
+    /// not be read from the same stream. Use \ref BasicECSVTable::from_mmap
+    /// to read gzip-compressed files.
     template <typename IStream>
     static auto read(IStream &is, std::vector<std::string> *lines = nullptr) {
+        constexpr auto gzip_magic = 0x1f;
+        if (is.peek() == gzip_magic) {
+            throw ParseError("unable to read header from gzip-compressed "
+                             "stream, use from_mmap");
+        }
         return std::apply(ECSVHeader::from_node, parse_header(is, lines));
     }
 
+    /// @brief Create ECSV header from the start of contiguous buffer
+    /// \p buf.
+    /// @param size Optional output of the size of the header.
+    /// @see \ref parse_header_view.
+    static auto read_view(std::string_view buf, std::size_t *size = nullptr)
+        -> ECSVHeader {
+        return std::apply(ECSVHeader::from_node, parse_header_view(buf, size));
+    }
+
     /// @brief Create ECSV header from parts.
     ECSVHeader(std::vector<ECSVColumn> cols, const YAML::Node &meta,
                char delimiter, std::optional<std::string> schema,
@@ -158,6 +228,12 @@ struct ECSVHeader {
 
     auto size() const noexcept { return cols().size(); }
 
+    /// @brief Return true if \p other has the same column names and types.
+    auto is_compatible(const ECSVHeader &other) const noexcept -> bool {
+        return std::ranges::equal(colnames(), other.colnames()) &&
+               std::ranges::equal(datatypes(), other.datatypes());
+    }
+
 private:
     std::vector<ECSVColumn> m_cols{};
     YAML::Node m_meta{};
@@ -176,7 +252,7 @@ struct formatter<tula::ecsv::ECSVColumn>
     // s: short form as <name>(<datatype>)
     // l: long form with full info
     template <typename FormatContext>
-    auto format(const tula::ecsv::ECSVColumn &col, FormatContext &ctx) {
+    auto format(const tula::ecsv::ECSVColumn &col, FormatContext &ctx) const {
         auto it = ctx.out();
         auto spec = spec_handler();
         switch (spec) {
@@ -196,7 +272,7 @@ template <>
 struct formatter<tula::ecsv::ECSVHeader>
     : tula::fmt_utils::nullspec_formatter_base {
     template <typename FormatContext>
-    auto format(const tula::ecsv::ECSVHeader &hdr, FormatContext &ctx) {
+    auto format(const tula::ecsv::ECSVHeader &hdr, FormatContext &ctx) const {
         auto it = ctx.out();
         return format_to(it, "ECSVHeader(ncols={})", hdr.cols().size());
     }
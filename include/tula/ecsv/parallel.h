@@ -0,0 +1,299 @@
+#pragma once
+
+#include "../grppi.h"
+#include "../logging.h"
+#include "../mmap.h"
+#include "table.h"
+#include "tokenizer.h"
+#include <exception>
+#include <numeric>
+#include <optional>
+#include <thread>
+
+namespace tula::ecsv {
+
+namespace internal {
+
+/// @brief The minimum size of chunk in bytes for parallel loading.
+constexpr std::size_t parallel_chunk_size_min = 1 << 20;
+
+/// @brief Return the default number of chunks to split \p size bytes into.
+inline auto default_n_chunks(std::size_t size) noexcept -> std::size_t {
+    constexpr std::size_t chunks_per_thread = 4;
+    auto n = chunks_per_thread *
+             std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    return std::clamp<std::size_t>(size / parallel_chunk_size_min, 1, n);
+}
+
+/**
+ * @brief Split \p buf to about \p n_chunks newline-aligned chunks.
+ *
+ * Newlines in quoted fields are not used as boundaries, so each chunk
+ * contains only whole rows. The quote state is tracked by counting the
+ * quote chars, which is valid because ECSV writers quote any field that
+ * contains a quote.
+ */
+inline auto split_chunks(std::string_view buf, std::size_t n_chunks)
+    -> std::vector<std::string_view> {
+    constexpr auto npos = std::string_view::npos;
+    constexpr auto quote = ECSVTokenizer::quote_char;
+    std::vector<std::string_view> chunks;
+    if (buf.empty()) {
+        return chunks;
+    }
+    auto target = buf.size() / std::max<std::size_t>(n_chunks, 1) + 1;
+    // without any quote we only need to look for the newlines.
+    bool has_quote = buf.find(quote) != npos;
+    bool in_quote = false;
+    std::size_t begin = 0;
+    std::size_t pos = 0;
+    while (begin < buf.size()) {
+        auto want = begin + target;
+        auto end = npos;
+        if (want < buf.size()) {
+            if (!has_quote) {
+                end = buf.find('\n', want);
+            } else {
+                for (; pos < buf.size(); ++pos) {
+                    auto c = buf[pos];
+                    if (c == quote) {
+                        in_quote = !in_quote;
+                    } else if (c == '\n' && !in_quote && pos >= want) {
+                        end = pos++;
+                        break;
+                    }
+                }
+            }
+        }
+        if (end == npos) {
+            chunks.push_back(buf.substr(begin));
+            break;
+        }
+        chunks.push_back(buf.substr(begin, end + 1 - begin));
+        begin = end + 1;
+    }
+    return chunks;
+}
+
+/// @brief Rethrow \p error from parsing the part of data section that
+/// starts at row \p row and byte \p offset, with the row numbers in the
+/// whole data section.
+[[noreturn]] inline void rethrow_part_error(const std::exception_ptr &error,
+                                            std::size_t row,
+                                            std::size_t offset) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const RowParseError &e) {
+        throw RowParseError(e.reason, e.row + row);
+    } catch (const ParseError &e) {
+        throw ParseError(fmt::format("{} in the rows from {} at byte {}",
+                                     e.what(), row, offset));
+    }
+}
+
+} // namespace internal
+
+/**
+ * @brief Load the ECSV data section \p buf to \p tbl in parallel.
+ *
+ * The data are split to newline-aligned chunks, which are parsed to
+ * per-chunk tables using the GRPPI execution mode \p ex_mode, and then
+ * moved to \p tbl.
+ * @param n_chunks The number of chunks. Zero to use a default based on
+ * the data size and the hardware concurrency.
+ */
+template <TableLayout layout, StringStorage string_storage>
+void load_rows_parallel(
+    BasicECSVTable<layout, string_storage> &tbl, std::string_view buf,
+    std::string_view ex_mode = grppi_utils::default_mode_name(),
+    std::size_t n_chunks = 0) {
+    if (n_chunks == 0) {
+        n_chunks = internal::default_n_chunks(buf.size());
+    }
+    auto chunks = internal::split_chunks(buf, n_chunks);
+    auto ex = grppi_utils::dyn_ex(ex_mode);
+    auto msg = fmt::format("load ECSV data of {} bytes in {} chunks mode={}",
+                           buf.size(), chunks.size(), ex_mode);
+    tula::logging::scoped_timeit TULA_X{msg};
+    const auto &hdr = tbl.header();
+    std::vector<std::optional<BasicECSVTable<layout, string_storage>>>
+        chunk_tables(chunks.size());
+    for (auto &t : chunk_tables) {
+        t.emplace(hdr, tbl.header_view().colnames(), tbl.stats_policy());
+    }
+    std::vector<std::size_t> chunk_indices(chunks.size());
+    std::iota(chunk_indices.begin(), chunk_indices.end(), 0);
+    std::vector<double> chunk_elapsed(chunks.size());
+    // the errors are rethrown after all chunks are done, because throwing
+    // from the worker threads terminates the process.
+    std::vector<std::exception_ptr> chunk_errors(chunks.size());
+    grppi::map(ex, chunk_indices.begin(), chunk_indices.end(),
+               chunk_elapsed.begin(), [&](auto i) {
+                   double elapsed{0};
+                   auto chunk_msg =
+                       fmt::format("parse chunk {}/{} of {} bytes", i,
+                                   chunks.size(), chunks[i].size());
+                   try {
+                       tula::logging::scoped_timeit TULA_X{chunk_msg,
+                                                           &elapsed};
+                       auto rows =
+                           ECSVTokenizer(chunks[i], hdr.delimiter());
+                       chunk_tables[i]->load_rows(rows,
+                                                  count_lines(chunks[i]));
+                   } catch (...) {
+                       chunk_errors[i] = std::current_exception();
+                   }
+                   return elapsed;
+               });
+    SPDLOG_DEBUG("chunk elapsed (ms): {}", chunk_elapsed);
+    std::size_t row_offset{0};
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (chunk_errors[i]) {
+            internal::rethrow_part_error(
+                chunk_errors[i], row_offset,
+                static_cast<std::size_t>(chunks[i].data() - buf.data()));
+        }
+        row_offset += chunk_tables[i]->rows();
+    }
+    std::vector<BasicECSVTable<layout, string_storage>> tables;
+    tables.reserve(chunk_tables.size());
+    for (auto &t : chunk_tables) {
+        tables.push_back(std::move(t.value()));
+    }
+    tbl.load_tables(tables);
+}
+
+/// @brief Create table from file by memory-mapping it, and load the data
+/// in parallel. Gzip-compressed files are loaded sequentially with
+/// \ref BasicECSVTable::from_mmap.
+/// @see \ref load_rows_parallel.
+template <TableLayout layout = TableLayout::col_major,
+          StringStorage string_storage = StringStorage::string>
+auto from_mmap_parallel(
+    const std::string &filepath,
+    std::string_view ex_mode = grppi_utils::default_mode_name(),
+    std::size_t n_chunks = 0) -> BasicECSVTable<layout, string_storage> {
+    using table_t = BasicECSVTable<layout, string_storage>;
+    auto file = tula::mmap_utils::MappedFile(filepath);
+    file.advise(tula::mmap_utils::Advice::willneed);
+    auto buf = file.view();
+    if (internal::is_gzip(buf)) {
+        // the compressed stream cannot be split to chunks
+        SPDLOG_DEBUG("load gzip-compressed {} sequentially", filepath);
+        return table_t::from_mmap(filepath);
+    }
+    std::size_t data_offset{0};
+    auto tbl = table_t(ECSVHeader::read_view(buf, &data_offset));
+    load_rows_parallel(tbl, buf.substr(data_offset), ex_mode, n_chunks);
+    return tbl;
+}
+
+/**
+ * @brief Create table from ECSV files of the same columns, with the rows
+ * concatenated in the order of \p filepaths.
+ *
+ * The headers are checked to be compatible with that of the first file.
+ * The files, which may be gzip-compressed, are memory-mapped and parsed
+ * to per-file tables using the GRPPI execution mode \p ex_mode, and then
+ * moved to the table, for which the storage is allocated once for the
+ * total number of rows.
+ * @param filepaths The files, e.g., from tula::filename_utils::find_regex.
+ * @param projection Optional column names or predicate to select the
+ * columns to load, and the stats policy.
+ */
+template <TableLayout layout = TableLayout::col_major,
+          StringStorage string_storage = StringStorage::string,
+          typename... Projection>
+auto from_mmap_concat(
+    const std::vector<std::string> &filepaths,
+    std::string_view ex_mode = grppi_utils::default_mode_name(),
+    Projection &&...projection) -> BasicECSVTable<layout, string_storage> {
+    using table_t = BasicECSVTable<layout, string_storage>;
+    if (filepaths.empty()) {
+        throw std::runtime_error("no ECSV files to concatenate");
+    }
+    auto tbl = table_t(
+        internal::read_file_header(
+            tula::mmap_utils::MappedFile(filepaths.front()).view(),
+            filepaths.front()),
+        std::forward<Projection>(projection)...);
+    auto ex = grppi_utils::dyn_ex(ex_mode);
+    auto msg = fmt::format("load {} ECSV files mode={}", filepaths.size(),
+                           ex_mode);
+    tula::logging::scoped_timeit TULA_X{msg};
+    std::vector<std::optional<table_t>> file_tables(filepaths.size());
+    std::vector<std::size_t> file_indices(filepaths.size());
+    std::iota(file_indices.begin(), file_indices.end(), 0);
+    std::vector<std::size_t> file_rows(filepaths.size());
+    // the errors are rethrown after all files are done, because throwing
+    // from the worker threads terminates the process.
+    std::vector<std::exception_ptr> file_errors(filepaths.size());
+    grppi::map(
+        ex, file_indices.begin(), file_indices.end(), file_rows.begin(),
+        [&](auto i) -> std::size_t {
+            try {
+                auto file = tula::mmap_utils::MappedFile(filepaths[i]);
+                file.advise(tula::mmap_utils::Advice::sequential);
+                auto buf = file.view();
+                auto load = [&](const ECSVHeader &hdr, auto &rows,
+                                std::size_t n_rows_hint) {
+                    if (!hdr.is_compatible(tbl.header())) {
+                        throw std::runtime_error(fmt::format(
+                            "incompatible columns: [{}] != [{}]",
+                            fmt::join(hdr.cols(), ", "),
+                            fmt::join(tbl.header().cols(), ", ")));
+                    }
+                    auto &t = file_tables[i].emplace(
+                        hdr, tbl.header_view().colnames(),
+                        tbl.stats_policy());
+                    t.load_rows(rows, n_rows_hint);
+                    return t.rows();
+                };
+                if (internal::is_gzip(buf)) {
+#if TULA_ECSV_HAS_ZLIB
+                    // decompress on this worker, without extra thread
+                    auto rows = ECSVGzipRows(
+                        buf, GzipBlockReader::default_block_size, false);
+                    return load(rows.header(), rows, 0);
+#else
+                    internal::throw_gzip_unsupported(filepaths[i],
+                                                     "without zlib");
+#endif
+                }
+                std::size_t data_offset{0};
+                auto hdr = ECSVHeader::read_view(buf, &data_offset);
+                auto data = buf.substr(data_offset);
+                auto rows = ECSVTokenizer(data, hdr.delimiter());
+                return load(hdr, rows, count_lines(data));
+            } catch (...) {
+                file_errors[i] = std::current_exception();
+                return 0;
+            }
+        });
+    for (std::size_t i = 0; i < filepaths.size(); ++i) {
+        if (!file_errors[i]) {
+            continue;
+        }
+        try {
+            std::rethrow_exception(file_errors[i]);
+        } catch (const RowParseError &e) {
+            throw RowParseError(
+                fmt::format("{} in {}", e.reason, filepaths[i]), e.row);
+        } catch (const ParseError &e) {
+            throw ParseError(fmt::format("{}: {}", filepaths[i], e.what()));
+        } catch (const std::exception &e) {
+            throw std::runtime_error(
+                fmt::format("{}: {}", filepaths[i], e.what()));
+        }
+    }
+    SPDLOG_DEBUG("file rows: {}", file_rows);
+    std::vector<table_t> tables;
+    tables.reserve(file_tables.size());
+    for (auto &t : file_tables) {
+        tables.push_back(std::move(t.value()));
+    }
+    tbl.load_tables(tables);
+    return tbl;
+}
+
+} // namespace tula::ecsv
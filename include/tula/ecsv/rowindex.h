@@ -0,0 +1,345 @@
+#pragma once
+
+#include "../container.h"
+#include "../mmap.h"
+#include "cache.h"
+#include "table.h"
+#include "tokenizer.h"
+#include <optional>
+
+namespace tula::ecsv {
+
+namespace internal {
+
+/// @brief Throw if the file \p filepath of content \p buf cannot be
+/// indexed, which is the case for gzip-compressed files.
+inline void check_indexable(std::string_view buf,
+                            const std::string &filepath) {
+    if (is_gzip(buf)) {
+        throw_gzip_unsupported(filepath,
+                               "with row index, decompress it first");
+    }
+}
+
+} // namespace internal
+
+/**
+ * @brief The byte offsets of every K-th row in the ECSV data section.
+ *
+ * With the index, a range of rows is read by seeking to the nearest
+ * indexed row before it and tokenizing at most K - 1 rows to skip. The
+ * row boundaries are found by scanning for the newlines, and the quote
+ * state is tracked by counting the quote chars as in
+ * \ref internal::split_chunks.
+ */
+struct ECSVRowIndex {
+    using index_t = std::size_t;
+    constexpr static std::size_t default_stride = 1024;
+    constexpr static std::array<char, 8> magic = {'T', 'U', 'L', 'A',
+                                                  'E', 'R', 'I', 'X'};
+    constexpr static std::uint64_t version = 1;
+
+    /// @brief Create index of the data section \p buf with an entry every
+    /// \p stride rows.
+    static auto build(std::string_view buf, std::size_t stride = default_stride)
+        -> ECSVRowIndex {
+        constexpr auto npos = std::string_view::npos;
+        if (stride == 0) {
+            throw std::runtime_error("row index stride has to be positive");
+        }
+        ECSVRowIndex index{};
+        index.m_stride = stride;
+        auto is_odd = [&buf](std::size_t begin, std::size_t end) {
+            end = std::min(end, buf.size());
+            return std::count(buf.begin() + static_cast<std::ptrdiff_t>(begin),
+                              buf.begin() + static_cast<std::ptrdiff_t>(end),
+                              ECSVTokenizer::quote_char) %
+                       2 ==
+                   1;
+        };
+        bool has_quote = buf.find(ECSVTokenizer::quote_char) != npos;
+        std::size_t pos = 0;
+        while (pos < buf.size()) {
+            // skip blank lines, as the tokenizer does
+            while (pos < buf.size() && (buf[pos] == '\n' || buf[pos] == '\r')) {
+                ++pos;
+            }
+            if (pos >= buf.size()) {
+                break;
+            }
+            if (index.m_n_rows % stride == 0) {
+                index.m_offsets.push_back(pos);
+            }
+            ++index.m_n_rows;
+            auto end = buf.find('\n', pos);
+            if (has_quote) {
+                // a newline in quoted field does not end the row
+                bool in_quote = is_odd(pos, end);
+                while (in_quote && end != npos) {
+                    auto next = buf.find('\n', end + 1);
+                    in_quote ^= is_odd(end + 1, next);
+                    end = next;
+                }
+            }
+            if (end == npos) {
+                break;
+            }
+            pos = end + 1;
+        }
+        return index;
+    }
+
+    auto stride() const noexcept -> std::size_t { return m_stride; }
+    auto rows() const noexcept -> std::size_t { return m_n_rows; }
+    /// @brief The offset of row i * stride is at i.
+    auto offsets() const noexcept -> const std::vector<std::uint64_t> & {
+        return m_offsets;
+    }
+
+    /// @brief Return the default index path of \p filepath.
+    static auto default_path(const std::string &filepath) -> std::string {
+        return filepath + ".tula_rowindex";
+    }
+
+    /// @brief Write the index to \p path, with \p key of the source file.
+    /// The file is written atomically, so concurrent writers of the same
+    /// index do not interleave.
+    void save(const std::string &path, const cache::Key &key) const {
+        cache::internal::write_atomic(path, [&](std::ofstream &os) {
+            os.write(magic.data(), magic.size());
+            for (std::uint64_t v :
+                 {version, key.size, static_cast<std::uint64_t>(key.mtime),
+                  key.hash, std::uint64_t(m_stride), std::uint64_t(m_n_rows),
+                  std::uint64_t(m_offsets.size())}) {
+                cache::internal::write_u64(os, v);
+            }
+            os.write(reinterpret_cast<const char *>( // NOLINT
+                         m_offsets.data()),
+                     static_cast<std::streamsize>(m_offsets.size() *
+                                                  sizeof(std::uint64_t)));
+        });
+    }
+
+    /// @brief Read the index from \p path.
+    /// Returns nullopt if the file does not exist or does not match \p key,
+    /// and throws if it is truncated or inconsistent.
+    static auto read(const std::string &path, const cache::Key &key)
+        -> std::optional<ECSVRowIndex> {
+        if (!cache::is_supported || !std::filesystem::exists(path)) {
+            return std::nullopt;
+        }
+        auto file = tula::mmap_utils::MappedFile(path);
+        auto buf = file.view();
+        if (buf.size() < magic.size() ||
+            !std::equal(magic.begin(), magic.end(), buf.begin())) {
+            SPDLOG_DEBUG("invalid ECSV row index {}", path);
+            return std::nullopt;
+        }
+        std::size_t pos = magic.size();
+        auto file_version = cache::internal::read_u64(buf, pos);
+        cache::Key file_key{};
+        file_key.size = cache::internal::read_u64(buf, pos);
+        file_key.mtime =
+            static_cast<std::int64_t>(cache::internal::read_u64(buf, pos));
+        file_key.hash = cache::internal::read_u64(buf, pos);
+        if (file_version != version || !(file_key == key)) {
+            SPDLOG_DEBUG("outdated ECSV row index {}", path);
+            return std::nullopt;
+        }
+        auto stride = cache::internal::read_u64(buf, pos);
+        auto n_rows = cache::internal::read_u64(buf, pos);
+        auto count = cache::internal::read_u64(buf, pos);
+        // the count is checked before allocating, and without overflow
+        if (count > (buf.size() - pos) / sizeof(std::uint64_t)) {
+            throw std::runtime_error(
+                fmt::format("truncated ECSV row index {}", path));
+        }
+        if (stride == 0 ||
+            count != n_rows / stride + (n_rows % stride == 0 ? 0 : 1)) {
+            throw std::runtime_error(
+                fmt::format("inconsistent ECSV row index {}", path));
+        }
+        ECSVRowIndex index{};
+        index.m_stride = stride;
+        index.m_n_rows = n_rows;
+        index.m_offsets.resize(count);
+        std::memcpy(index.m_offsets.data(), buf.data() + pos,
+                    count * sizeof(std::uint64_t));
+        return index;
+    }
+
+private:
+    std::size_t m_stride{default_stride};
+    std::size_t m_n_rows{0};
+    std::vector<std::uint64_t> m_offsets{};
+};
+
+/**
+ * @brief Read the rows start:stop:step of the data section.
+ *
+ * This is a single-pass range of the fields of the rows, as
+ * \ref ECSVTokenizer. When the next row is in a later block of the index,
+ * the reading seeks to the indexed offset instead of tokenizing the rows
+ * in between.
+ */
+struct ECSVSliceReader {
+    using fields_t = ECSVTokenizer::fields_t;
+
+    ECSVSliceReader(std::string_view buf, char delimiter,
+                    const ECSVRowIndex &index, std::size_t start,
+                    std::size_t step, std::size_t size)
+        : m_buf{buf}, m_delim{delimiter}, m_index{index}, m_start{start},
+          m_step{step}, m_size{size} {}
+
+    /// @brief Read the next row to \p fields. Returns false if no more rows.
+    auto next(fields_t &fields) -> bool {
+        if (m_n_read == m_size) {
+            return false;
+        }
+        auto row = m_start + m_n_read * m_step;
+        auto block = row / m_index.stride();
+        if (!m_rows.has_value() || block * m_index.stride() > m_row) {
+            m_rows.emplace(m_buf.substr(m_index.offsets().at(block)), m_delim);
+            m_row = block * m_index.stride();
+        }
+        for (; m_row <= row; ++m_row) {
+            if (!m_rows->next(fields)) {
+                throw ParseError(
+                    fmt::format("row {} is out of the data section", row));
+            }
+        }
+        ++m_n_read;
+        return true;
+    }
+
+    struct iterator {
+        ECSVSliceReader *reader{nullptr};
+        fields_t fields{};
+        bool done{true};
+
+        auto operator*() const noexcept -> const fields_t & { return fields; }
+        auto operator->() const noexcept -> const fields_t * {
+            return &fields;
+        }
+        auto operator++() -> iterator & {
+            done = !reader->next(fields);
+            return *this;
+        }
+        auto operator==(const iterator &other) const noexcept -> bool {
+            return done == other.done;
+        }
+    };
+    auto begin() -> iterator {
+        iterator it{this};
+        ++it;
+        return it;
+    }
+    auto end() -> iterator { return iterator{this}; }
+
+private:
+    std::string_view m_buf;
+    char m_delim;
+    const ECSVRowIndex &m_index;
+    std::size_t m_start;
+    std::size_t m_step;
+    std::size_t m_size;
+    std::size_t m_n_read{0};
+    /// @brief The index of the next row to be read by the tokenizer.
+    std::size_t m_row{0};
+    std::optional<ECSVTokenizer> m_rows{};
+};
+
+/// @brief Load the rows in \p slice of the data section \p buf to \p tbl.
+/// The slice is python-like, e.g., from
+/// tula::container_utils::parse_slice, and the step has to be positive.
+template <TableLayout layout, StringStorage string_storage>
+void load_rows_slice(BasicECSVTable<layout, string_storage> &tbl,
+                     std::string_view buf, const ECSVRowIndex &index,
+                     const container_utils::IndexSlice &slice) {
+    auto [start, stop, step, size] =
+        container_utils::to_indices(slice, Eigen::Index(index.rows()));
+    if (step <= 0) {
+        throw std::runtime_error(
+            fmt::format("invalid step {} of row slice", step));
+    }
+    SPDLOG_DEBUG("load rows {}:{}:{} of {} rows", start, stop, step,
+                 index.rows());
+    auto rows = ECSVSliceReader(buf, tbl.header().delimiter(), index,
+                                std::size_t(start), std::size_t(step),
+                                std::size_t(size));
+    tbl.load_rows(rows, std::size_t(size));
+}
+
+/// @brief Return the row index of ECSV file \p filepath, built in memory.
+inline auto row_index(const std::string &filepath,
+                      std::size_t stride = ECSVRowIndex::default_stride)
+    -> ECSVRowIndex {
+    auto file = tula::mmap_utils::MappedFile(filepath);
+    file.advise(tula::mmap_utils::Advice::sequential);
+    auto buf = file.view();
+    internal::check_indexable(buf, filepath);
+    return ECSVRowIndex::build(buf.substr(header_size(buf)), stride);
+}
+
+/// @brief Return the row index of ECSV file \p filepath, read from
+/// \p indexpath if valid or built and saved to it otherwise.
+/// The index path defaults to the file path with ".tula_rowindex"
+/// appended. Failing to read or save the index is logged as warning only.
+inline auto
+row_index_cached(const std::string &filepath,
+                 std::optional<std::string> indexpath = std::nullopt,
+                 std::size_t stride = ECSVRowIndex::default_stride)
+    -> ECSVRowIndex {
+    auto path = indexpath.value_or(ECSVRowIndex::default_path(filepath));
+    auto file = tula::mmap_utils::MappedFile(filepath);
+    auto buf = file.view();
+    internal::check_indexable(buf, filepath);
+    auto data_offset = header_size(buf);
+    auto key = cache::make_key(filepath, buf.substr(0, data_offset));
+    std::optional<ECSVRowIndex> saved{};
+    try {
+        saved = ECSVRowIndex::read(path, key);
+    } catch (const std::exception &e) {
+        // a broken index is rebuilt and overwritten
+        SPDLOG_WARN("unable to read ECSV row index {}: {}", path, e.what());
+    }
+    if (saved.has_value() && saved->stride() == stride) {
+        return std::move(saved.value());
+    }
+    auto index = ECSVRowIndex::build(buf.substr(data_offset), stride);
+    if constexpr (cache::is_supported) {
+        try {
+            index.save(path, key);
+        } catch (const std::exception &e) {
+            // the index is valid without the saved copy
+            SPDLOG_WARN("unable to save ECSV row index {}: {}", path,
+                        e.what());
+        }
+    }
+    return index;
+}
+
+/// @brief Create table of the rows in \p slice of ECSV file, using the
+/// row index \p index of the file.
+/// @param projection Optional column names or predicate to select the
+/// columns to load, and the stats policy.
+template <TableLayout layout = TableLayout::col_major,
+          StringStorage string_storage = StringStorage::string,
+          typename... Projection>
+auto from_mmap_slice(const std::string &filepath, const ECSVRowIndex &index,
+                     const container_utils::IndexSlice &slice,
+                     Projection &&...projection)
+    -> BasicECSVTable<layout, string_storage> {
+    auto file = tula::mmap_utils::MappedFile(filepath);
+    file.advise(tula::mmap_utils::Advice::random);
+    auto buf = file.view();
+    internal::check_indexable(buf, filepath);
+    std::size_t data_offset{0};
+    auto tbl = BasicECSVTable<layout, string_storage>(
+        ECSVHeader::read_view(buf, &data_offset),
+        std::forward<Projection>(projection)...);
+    load_rows_slice(tbl, buf.substr(data_offset), index, slice);
+    return tbl;
+}
+
+} // namespace tula::ecsv
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "../formatter/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fmt/core.h>
+#include <limits>
+#include <type_traits>
+
+namespace tula::ecsv {
+
+/**
+ * @brief Statistics of a numeric column.
+ *
+ * The values are accumulated as double. NaN values are counted in
+ * \ref nan_count only, and the other values, including infinities, are
+ * counted in \ref count and the min, max and sum. The infinities are also
+ * counted in \ref inf_count, and are not included in the mean and
+ * variance, which are of the finite values.
+ *
+ * The mean and variance are accumulated with Welford's update, and
+ * combined with Chan's formula in \ref merge, so they keep the precision
+ * for columns with large offsets, e.g., MJD timestamps.
+ */
+struct ColumnStats {
+    std::size_t count{0};
+    std::size_t nan_count{0};
+    std::size_t inf_count{0};
+    double min{std::numeric_limits<double>::infinity()};
+    double max{-std::numeric_limits<double>::infinity()};
+    double sum{0};
+
+    template <typename T>
+    void add(T value) noexcept {
+        auto v = static_cast<double>(value);
+        if constexpr (std::is_floating_point_v<T>) {
+            if (std::isnan(v)) {
+                ++nan_count;
+                return;
+            }
+        }
+        ++count;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        sum += v;
+        if constexpr (std::is_floating_point_v<T>) {
+            if (std::isinf(v)) {
+                ++inf_count;
+                return;
+            }
+        }
+        auto delta = v - m_mean;
+        m_mean += delta / static_cast<double>(finite_count());
+        m_m2 += delta * (v - m_mean);
+    }
+
+    /// @brief Add the values accumulated in \p other.
+    void merge(const ColumnStats &other) noexcept {
+        nan_count += other.nan_count;
+        if (other.count == 0) {
+            return;
+        }
+        if (other.finite_count() > 0) {
+            auto n_a = static_cast<double>(finite_count());
+            auto n_b = static_cast<double>(other.finite_count());
+            auto n = n_a + n_b;
+            auto delta = other.m_mean - m_mean;
+            m_mean += delta * n_b / n;
+            m_m2 += other.m_m2 + delta * delta * n_a * n_b / n;
+        }
+        count += other.count;
+        inf_count += other.inf_count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+    }
+
+    /// @brief The number of the finite values.
+    auto finite_count() const noexcept -> std::size_t {
+        return count - inf_count;
+    }
+    /// @brief The mean of the finite values.
+    auto mean() const noexcept -> double {
+        return finite_count() == 0 ? std::numeric_limits<double>::quiet_NaN()
+                                   : m_mean;
+    }
+    /// @brief The population variance of the finite values.
+    auto var() const noexcept -> double {
+        if (finite_count() == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return std::max(m_m2 / static_cast<double>(finite_count()), 0.);
+    }
+    auto stddev() const noexcept -> double { return std::sqrt(var()); }
+
+private:
+    double m_mean{0};
+    // The sum of squared deviations from the mean.
+    double m_m2{0};
+};
+
+/// @brief True if statistics are collected for columns of type \p T.
+template <typename T>
+constexpr bool has_column_stats =
+    std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+/// @brief The type-erased accumulator that adds the value at \p src.
+using stats_accumulator_t = void (*)(const void *, ColumnStats &);
+
+/// @brief Return the accumulator for type \p T, or nullptr if
+/// statistics are not collected for \p T.
+template <typename T>
+constexpr auto stats_accumulator() noexcept -> stats_accumulator_t {
+    if constexpr (has_column_stats<T>) {
+        return [](const void *src, ColumnStats &stats) {
+            stats.add(*static_cast<const T *>(src));
+        };
+    } else {
+        return nullptr;
+    }
+}
+
+/// @brief Whether tables collect the column statistics when loading.
+enum class ColumnStatsPolicy {
+    skip,    ///< Statistics are computed from the data on request.
+    collect, ///< Statistics are accumulated while decoding the rows.
+};
+
+} // namespace tula::ecsv
+
+namespace fmt {
+template <>
+struct formatter<tula::ecsv::ColumnStats>
+    : tula::fmt_utils::nullspec_formatter_base {
+    template <typename FormatContext>
+    auto format(const tula::ecsv::ColumnStats &stats,
+                FormatContext &ctx) const {
+        auto it = ctx.out();
+        return format_to(it,
+                         "count={} nan_count={} inf_count={} min={} max={} "
+                         "mean={} stddev={}",
+                         stats.count, stats.nan_count, stats.inf_count,
+                         stats.min, stats.max, stats.mean(), stats.stddev());
+    }
+};
+} // namespace fmt
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "../mmap.h"
+#include "gzip.h"
+#include "table.h"
+#include "tokenizer.h"
+
+namespace tula::ecsv {
+
+/**
+ * @brief Read ECSV data in fixed-size batches of rows.
+ *
+ * The rows are decoded to one set of column buffers that is allocated for
+ * the batch size and re-used for all batches, so the memory is bounded
+ * regardless of the number of rows. Only the columns selected by the
+ * projection are decoded; other fields are split by the tokenizer and then
+ * skipped.
+ */
+struct ECSVStreamReader {
+    using index_t = ECSVHeaderView::index_t;
+    using label_t = ECSVHeaderView::label_t;
+    using table_data_traits = ECSVTable::table_data_traits;
+    using table_data_t = table_data_traits::value_t;
+    using loader_t = table_data_traits::loader_t;
+    constexpr static std::size_t default_batch_size = 1 << 14;
+
+    ECSVStreamReader(ECSVHeader hdr,
+                     std::size_t batch_size = default_batch_size)
+        : ECSVStreamReader{std::move(hdr), [](const auto &) { return true; },
+                           batch_size} {}
+
+    /// @brief Create reader that decodes columns \p colnames only.
+    ECSVStreamReader(ECSVHeader hdr, std::vector<label_t> colnames,
+                     std::size_t batch_size = default_batch_size)
+        : m_hdr{std::make_unique<ECSVHeader>(std::move(hdr))},
+          m_hdr_view{*m_hdr, std::move(colnames)},
+          m_data{table_data_traits::init_value(*m_hdr, m_hdr_view)},
+          m_loader{table_data_traits::init_loader(*m_hdr, m_data)},
+          m_batch_size{batch_size} {
+        m_loader.truncate(0);
+    }
+
+    /// @brief Create reader that decodes columns selected by \p pred only.
+    template <typename Pred>
+    requires tula::meta::Invocable<Pred, const ECSVColumn &>
+    ECSVStreamReader(ECSVHeader hdr, Pred &&pred,
+                     std::size_t batch_size = default_batch_size)
+        : m_hdr{std::make_unique<ECSVHeader>(std::move(hdr))},
+          m_hdr_view{*m_hdr, std::forward<Pred>(pred)},
+          m_data{table_data_traits::init_value(*m_hdr, m_hdr_view)},
+          m_loader{table_data_traits::init_loader(*m_hdr, m_data)},
+          m_batch_size{batch_size} {
+        m_loader.truncate(0);
+    }
+
+    // The loader refers to the data buffers.
+    ECSVStreamReader(const ECSVStreamReader &) = delete;
+    ECSVStreamReader(ECSVStreamReader &&) = delete;
+    auto operator=(const ECSVStreamReader &) -> ECSVStreamReader & = delete;
+    auto operator=(ECSVStreamReader &&) -> ECSVStreamReader & = delete;
+    ~ECSVStreamReader() = default;
+
+    auto header() const -> const ECSVHeader & { return *m_hdr; }
+    /// @brief The view of the selected columns.
+    auto header_view() const -> const ECSVHeaderView & { return m_hdr_view; }
+    auto batch_size() const noexcept -> std::size_t { return m_batch_size; }
+    /// @brief The number of rows in the current batch.
+    auto rows() const noexcept -> std::size_t { return m_batch_rows; }
+    /// @brief The index of the first row of the current batch.
+    auto row_offset() const noexcept -> std::size_t { return m_row_offset; }
+
+    /// @brief Return column of the current batch.
+    /// The data are valid until the next batch is read.
+    template <internal::ECSVDataType T>
+    auto col(const label_t &name) {
+        auto &array_data = std::get<ArrayData<T>>(m_data);
+        if (array_data.empty() ||
+            std::ranges::find(array_data.colnames(), name) ==
+                array_data.colnames().end()) {
+            throw std::runtime_error(fmt::format(
+                "column {} of type {} is not selected", name, dtype_str<T>()));
+        }
+        return array_data(name);
+    }
+
+    /// @brief Read up to batch size rows from \p rows to the buffers.
+    /// Returns the number of rows read, which is zero when \p rows is
+    /// exhausted. The reading resumes from where \p rows is left, so
+    /// \p rows has to be a single-pass range such as \ref ECSVTokenizer.
+    template <tula::meta::Iterable It>
+    auto read_batch(It &rows) -> std::size_t {
+        m_row_offset += m_batch_rows;
+        if (m_batch_rows < m_batch_size) {
+            // allocate the buffers, for the first batch or after a short one
+            m_loader.truncate(m_batch_size);
+        }
+        index_t row_idx = 0;
+        if (m_batch_size > 0) {
+            for (const auto &row : rows) {
+                auto row_size = row.size();
+                if (row_size != m_hdr->size()) {
+                    throw RowParseError(
+                        fmt::format("inconsistent number of fields {} != {}",
+                                    row_size, m_hdr->size()),
+                        m_row_offset + row_idx);
+                }
+                m_loader.decode_row(row_idx, row);
+                if (++row_idx == m_batch_size) {
+                    break;
+                }
+            }
+        }
+        // only the last batch can be short, in which case the buffers are
+        // truncated so the columns have exactly the batch rows.
+        if (row_idx < m_batch_size) {
+            m_loader.truncate(row_idx);
+        }
+        m_batch_rows = row_idx;
+        return m_batch_rows;
+    }
+
+    /// @brief Call \p func with this reader for each batch in \p rows.
+    template <tula::meta::Iterable It, typename F>
+    void for_each_batch(It &rows, F &&func) {
+        while (read_batch(rows) > 0) {
+            func(*this);
+        }
+    }
+
+private:
+    std::unique_ptr<ECSVHeader> m_hdr;
+    ECSVHeaderView m_hdr_view;
+    table_data_t m_data;
+    loader_t m_loader;
+    std::size_t m_batch_size;
+    std::size_t m_batch_rows{0};
+    std::size_t m_row_offset{0};
+};
+
+/// @brief Read ECSV file in batches by memory-mapping it.
+/// Gzip-compressed files are decompressed in blocks with
+/// \ref ECSVGzipRows.
+/// @param args The column projection and batch size passed to
+/// \ref ECSVStreamReader.
+/// @param func Called with the reader for each batch.
+template <typename F, typename... Args>
+void stream_mmap(const std::string &filepath, F &&func, Args &&...args) {
+    auto file = tula::mmap_utils::MappedFile(filepath);
+    file.advise(tula::mmap_utils::Advice::sequential);
+    auto buf = file.view();
+    if (internal::is_gzip(buf)) {
+#if TULA_ECSV_HAS_ZLIB
+        auto rows = ECSVGzipRows(buf);
+        auto reader =
+            ECSVStreamReader(rows.header(), std::forward<Args>(args)...);
+        reader.for_each_batch(rows, std::forward<F>(func));
+        return;
+#else
+        internal::throw_gzip_unsupported(filepath, "without zlib");
+#endif
+    }
+    std::size_t data_offset{0};
+    auto reader = ECSVStreamReader(ECSVHeader::read_view(buf, &data_offset),
+                                   std::forward<Args>(args)...);
+    auto rows =
+        ECSVTokenizer(buf.substr(data_offset), reader.header().delimiter());
+    reader.for_each_batch(rows, std::forward<F>(func));
+}
+
+} // namespace tula::ecsv
@@ -2,12 +2,22 @@
 
 #include "../container.h"
 #include "../eigen.h"
+#include "../mmap.h"
+#include "../nddata/cacheddata.h"
 #include "../nddata/eigen.h"
 #include "../nddata/labelmapper.h"
+#include "arena.h"
+#include "decoder.h"
+#include "filter.h"
+#include "gzip.h"
 #include "hdr.h"
+#include "stats.h"
+#include "tokenizer.h"
 #include "tula/meta.h"
 #include <functional>
+#include <memory>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 
 namespace tula::ecsv {
@@ -43,7 +53,8 @@ auto get_colnames_filtered(const ECSVHeader &hdr, Pred &&pred) {
 template <typename T>
 concept ECSVDataType =
     tula::meta::Arithmetic<T> ||
-    tula::meta::is_instance<T, std::complex>::value || tula::meta::String<T>;
+    tula::meta::is_instance<T, std::complex>::value ||
+    tula::meta::String<T> || tula::meta::StringView<T>;
 
 constexpr std::size_t array_data_block_size = 1024;
 
@@ -54,14 +65,22 @@ using eigen_array_data_t = Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic,
 template <ECSVDataType T>
 using std_array_data_t = std::vector<std::vector<T>>;
 
+/// @brief String columns of string view type are stored in arenas.
+using arena_array_data_t = std::vector<StringArena>;
+
+template <ECSVDataType T>
+constexpr static bool use_arena_array_data = tula::meta::StringView<T>;
+
 template <ECSVDataType T>
 constexpr static bool use_eigen_array_data =
-    !tula::meta::is_instance<T, std::basic_string>::value;
+    !tula::meta::is_instance<T, std::basic_string>::value &&
+    !use_arena_array_data<T>;
 
 template <ECSVDataType T, auto order = Eigen::ColMajor>
-using array_data_t =
-    std::conditional_t<use_eigen_array_data<T>, eigen_array_data_t<T, order>,
-                       std_array_data_t<T>>;
+using array_data_t = std::conditional_t<
+    use_eigen_array_data<T>, eigen_array_data_t<T, order>,
+    std::conditional_t<use_arena_array_data<T>, arena_array_data_t,
+                       std_array_data_t<T>>>;
 
 } // namespace internal
 
@@ -116,7 +135,8 @@ struct ECSVHeaderView : tula::nddata::LabelMapper<ECSVHeaderView> {
     }
 
     /// @brief Return the list of indices of columns in the original header.
-    [[nodiscard]] auto indices() const -> decltype(auto) {
+    [[nodiscard]] auto indices() const noexcept
+        -> const std::vector<index_t> & {
         return this->m_view_index;
     }
 
@@ -145,39 +165,94 @@ struct ColDataRef {
     using col_data_t = col_data_t_;
     constexpr static auto is_eigen_data =
         internal::use_eigen_array_data<value_t>;
+    constexpr static auto is_arena_data =
+        internal::use_arena_array_data<value_t>;
 
     col_data_t data;
     const ECSVColumn &col;
 
-    auto operator()(index_t idx) -> value_t & {
+    auto operator()(index_t idx) -> decltype(auto) {
         if constexpr (is_eigen_data) {
             return data.coeffRef(idx);
         } else {
+            // for arena data this is the string view of the value
             return data[idx];
         }
     }
-    auto operator()(index_t idx) const -> const value_t & {
+    auto operator()(index_t idx) const -> decltype(auto) {
         if constexpr (is_eigen_data) {
-            return data.coeffRef(idx);
-        } else {
+            return std::as_const(data.coeffRef(idx));
+        } else if constexpr (is_arena_data) {
             return data[idx];
+        } else {
+            return std::as_const(data[idx]);
         }
     }
 
+    /// @brief Set the value at \p idx to \p value.
+    /// For arena data, only the rows after the filled rows, or the last
+    /// filled row, can be set, as the arena is filled in order.
     template <typename T>
     auto set_value(index_t idx, const T &value) {
         // this checks the value T for string like, and dispatch coordingly
-        if constexpr ((is_eigen_data && !tula::meta::StringLike<T>) ||
-                      (!is_eigen_data && tula::meta::StringLike<T>)) {
+        if constexpr (is_arena_data && tula::meta::StringLike<T>) {
+            check_arena_index(idx);
+            data.set(idx, value);
+        } else if constexpr ((is_eigen_data && !tula::meta::StringLike<T>) ||
+                             (!is_eigen_data && tula::meta::StringLike<T>)) {
             this->operator()(idx) = value;
         }
     }
+
+    /// @brief Decode text field \p s and store the value at \p idx.
+    auto decode_value(index_t idx, std::string_view s) -> bool {
+        if constexpr (is_arena_data) {
+            check_arena_index(idx);
+            data.set(idx, s);
+            return true;
+        } else {
+            return decode_field(s, this->operator()(idx));
+        }
+    }
+
+private:
+    /// @brief Throw if setting row \p idx of arena data would discard the
+    /// rows after it.
+    void check_arena_index(index_t idx) const {
+        if (idx + 1 < data.filled()) {
+            throw std::runtime_error(fmt::format(
+                "unable to set row {} of string arena column {} with {} rows "
+                "filled",
+                idx, col.name, data.filled()));
+        }
+    }
+};
+
+/// @brief The non-owning map of the data of column of type \p T, which
+/// are strided in row-major layout.
+template <internal::ECSVDataType T>
+requires internal::use_eigen_array_data<T>
+using ColMap = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>, Eigen::Unaligned,
+                          Eigen::InnerStride<>>;
+template <internal::ECSVDataType T>
+requires internal::use_eigen_array_data<T>
+using ConstColMap =
+    Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>, Eigen::Unaligned,
+               Eigen::InnerStride<>>;
+
+/// @brief The policy to grow the number of rows of array data.
+enum class GrowthPolicy {
+    block,     ///< Grow to the next multiple of block size.
+    geometric, ///< Grow to at least twice the current size, in blocks.
+    exact,     ///< Grow to exactly the requested size after a row count
+               ///< hint is given with reserve, and as geometric before.
 };
 
 /// @brief ECSV data object.
 template <internal::ECSVDataType T,
           std::size_t block_size_ = internal::array_data_block_size,
-          Eigen::StorageOptions order = Eigen::ColMajor>
+          Eigen::StorageOptions order = Eigen::ColMajor,
+          GrowthPolicy growth_policy_ = GrowthPolicy::geometric>
 struct ArrayData : ECSVHeaderView {
     using Base = ECSVHeaderView;
     using index_t = Base::index_t;
@@ -187,7 +262,12 @@ struct ArrayData : ECSVHeaderView {
     using data_t = internal::array_data_t<T, order>;
     constexpr static auto is_eigen_data =
         internal::use_eigen_array_data<value_t>;
+    constexpr static auto is_arena_data =
+        internal::use_arena_array_data<value_t>;
     constexpr static auto block_size = block_size_;
+    constexpr static auto growth_policy = growth_policy_;
+    /// @brief The size of the tiles to transpose between storage orders.
+    constexpr static std::size_t transpose_tile_size = 32;
 
     ArrayData(ECSVHeaderView hdr_view) : Base{std::move(hdr_view)} {
         this->init_data();
@@ -212,8 +292,8 @@ struct ArrayData : ECSVHeaderView {
             return ColDataRef<value_t, decltype(data_col)>{data_col,
                                                            this->col(idx)};
         } else {
-            return ColDataRef<value_t, std::vector<value_t> &>{data.at(idx),
-                                                               this->col(idx)};
+            return ColDataRef<value_t, typename data_t::value_type &>{
+                data.at(idx), this->col(idx)};
         }
     }
 
@@ -223,7 +303,7 @@ struct ArrayData : ECSVHeaderView {
             return ColDataRef<value_t, decltype(data_col)>{data_col,
                                                            this->col(idx)};
         } else {
-            return ColDataRef<value_t, const std::vector<value_t> &>{
+            return ColDataRef<value_t, const typename data_t::value_type &>{
                 data.at(idx), this->col(idx)};
         }
     }
@@ -239,6 +319,11 @@ struct ArrayData : ECSVHeaderView {
         this->ensure_row_size_for_index(idx);
         if constexpr (is_eigen_data) {
             return data.row(idx);
+        } else if constexpr (is_arena_data) {
+            return std::ranges::transform_view(
+                data, [idx = idx](const auto &value) -> std::string_view {
+                    return value.at(idx);
+                });
         } else {
             // We need to build a view to the idx-th element in each vector
             return std::ranges::transform_view(
@@ -270,6 +355,66 @@ struct ArrayData : ECSVHeaderView {
             }
         }
     }
+    /// @brief Move all rows of \p other to the rows starting at \p offset.
+    /// The rows have to be allocated already.
+    void assign_rows(index_t offset, ArrayData &&other) {
+        auto n = other.row_size();
+        if (this->empty() || n == 0) {
+            return;
+        }
+        assert(offset + n <= this->row_size());
+        if constexpr (is_eigen_data) {
+            this->data.middleRows(offset, n) = other.data;
+        } else if constexpr (is_arena_data) {
+            for (std::size_t j = 0; j < this->data.size(); ++j) {
+                this->data[j].assign_rows(offset, other.data[j], n);
+            }
+        } else {
+            for (std::size_t j = 0; j < this->data.size(); ++j) {
+                std::move(other.data[j].begin(), other.data[j].end(),
+                          this->data[j].begin() + offset);
+            }
+        }
+    }
+
+    /// @brief Copy the first \p n rows of \p other, which can have a
+    /// different storage order, to the rows starting at \p offset.
+    /// The rows have to be allocated already. When the storage orders
+    /// differ, the Eigen data are transposed in tiles of
+    /// \ref transpose_tile_size rows and columns.
+    template <std::size_t other_block_size, Eigen::StorageOptions other_order,
+              GrowthPolicy other_growth_policy>
+    void assign_rows(index_t offset,
+                     ArrayData<T, other_block_size, other_order,
+                               other_growth_policy> &other,
+                     index_t n) {
+        if (this->empty() || n == 0) {
+            return;
+        }
+        assert(offset + n <= this->row_size() && n <= other.row_size());
+        if constexpr (is_eigen_data) {
+            auto n_cols = this->data.cols();
+            constexpr auto tile = Eigen::Index(transpose_tile_size);
+            for (Eigen::Index j = 0; j < n_cols; j += tile) {
+                auto m = std::min(tile, n_cols - j);
+                for (Eigen::Index i = 0; i < Eigen::Index(n); i += tile) {
+                    auto k = std::min(tile, Eigen::Index(n) - i);
+                    this->data.block(Eigen::Index(offset) + i, j, k, m) =
+                        other.data.block(i, j, k, m);
+                }
+            }
+        } else if constexpr (is_arena_data) {
+            for (std::size_t j = 0; j < this->data.size(); ++j) {
+                this->data[j].assign_rows(offset, other.data[j], n);
+            }
+        } else {
+            for (std::size_t j = 0; j < this->data.size(); ++j) {
+                std::move(other.data[j].begin(), other.data[j].begin() + n,
+                          this->data[j].begin() + offset);
+            }
+        }
+    }
+
     auto row_size() const noexcept -> index_t {
         if (this->empty()) {
             return 0;
@@ -285,18 +430,53 @@ struct ArrayData : ECSVHeaderView {
         }
     }
 
-    void ensure_row_size_for_index(index_t idx) {
+    /// @brief Return the pointer to the first element of column \p idx and
+    /// the stride between rows in number of elements.
+    /// This is not available for arena data, of which the values are not
+    /// stored as objects.
+    auto col_data(index_t idx) -> std::pair<value_t *, std::ptrdiff_t>
+    requires(!is_arena_data) {
+        if constexpr (is_eigen_data) {
+            auto data_col = data.col(idx);
+            return {data_col.data(), data_col.innerStride()};
+        } else {
+            return {data[idx].data(), 1};
+        }
+    }
+    auto col_data(index_t idx) const
+        -> std::pair<const value_t *, std::ptrdiff_t>
+    requires(!is_arena_data) {
+        if constexpr (is_eigen_data) {
+            auto data_col = data.col(idx);
+            return {data_col.data(), data_col.innerStride()};
+        } else {
+            return {data[idx].data(), 1};
+        }
+    }
+
+    /// @brief Grow the data to hold row \p idx.
+    /// Returns true if the data are re-allocated.
+    auto ensure_row_size_for_index(index_t idx) -> bool {
         if (this->empty()) {
             // no-op if empty
-            return;
+            return false;
         }
-        auto get_new_size = [](index_t old_size,
-                               index_t idx) -> std::optional<index_t> {
+        // exact growth without hint would re-allocate for every row
+        auto is_exact = growth_policy == GrowthPolicy::exact && m_reserved;
+        auto get_new_size = [is_exact](index_t old_size,
+                                       index_t idx) -> std::optional<index_t> {
             SPDLOG_TRACE("check row size for idx: old_size={} idx={}", old_size,
                          idx);
-            // here we always requrest n_rows as multiples of block_size
+            // here we requrest n_rows as multiples of block_size unless
+            // the growth policy is exact
             if (idx >= old_size) {
                 auto new_size = idx + 1;
+                if (is_exact) {
+                    return new_size;
+                }
+                if constexpr (growth_policy != GrowthPolicy::block) {
+                    new_size = std::max(new_size, 2 * old_size);
+                }
                 auto n_blocks =
                     new_size / block_size + index_t(new_size % block_size > 0);
                 SPDLOG_TRACE("computed n_blocks={}", n_blocks);
@@ -316,11 +496,30 @@ struct ArrayData : ECSVHeaderView {
         auto new_size = get_new_size(this->row_size(), idx);
         if (new_size.has_value()) {
             this->truncate(new_size.value());
+            return true;
         }
+        return false;
+    }
+
+    /// @brief Allocate the data to hold exactly \p n rows if there are
+    /// fewer. Returns true if the data are re-allocated.
+    auto reserve(index_t n) -> bool {
+        m_reserved = true;
+        if (this->empty() || n <= this->row_size()) {
+            return false;
+        }
+        this->truncate(n);
+        return true;
     }
 
 private:
+    template <internal::ECSVDataType, std::size_t, Eigen::StorageOptions,
+              GrowthPolicy>
+    friend struct ArrayData;
+
     data_t data;
+    /// @brief True if a row count hint is given with \ref reserve.
+    bool m_reserved{false};
     void init_data() {
         if (this->empty()) {
             // do not do any initialization as this does not hold any data.
@@ -346,6 +545,32 @@ struct ECSVDataLoader {
     using label_t = ECSVHeaderView::label_t;
     using ref_t = std::variant<std::reference_wrapper<ArrayDataTypes>...>;
     using refs_t = std::vector<ref_t>;
+    /// @brief The entry of the decode plan.
+    /// It decodes field at \p field_idx to \p data + row_idx * \p stride.
+    struct PlanEntry {
+        index_t field_idx;
+        field_decoder_t decode;
+        std::byte *data;
+        std::ptrdiff_t stride;
+    };
+    using plan_t = std::vector<PlanEntry>;
+    /// @brief The entry of the decode plan for arena data, which stores
+    /// field at \p field_idx to \p arena.
+    struct ArenaPlanEntry {
+        index_t field_idx;
+        StringArena *arena;
+    };
+    using arena_plan_t = std::vector<ArenaPlanEntry>;
+    /// @brief The entry of the stats plan, which adds the decoded value at
+    /// \p data + row_idx * \p stride to \p stats.
+    struct StatsPlanEntry {
+        stats_accumulator_t accumulate;
+        const std::byte *data;
+        std::ptrdiff_t stride;
+        ColumnStats *stats;
+    };
+    using stats_plan_t = std::vector<StatsPlanEntry>;
+
     ECSVDataLoader(const ECSVHeader &hdr, ArrayDataTypes &...array_data_)
         : m_hdr_view{hdr}, m_array_data_refs{std::ref(array_data_)...} {
         m_ref_index.resize(m_hdr_view.size());
@@ -364,8 +589,12 @@ struct ECSVDataLoader {
                 m_ref_index[col_idx].emplace_back(i, j);
             }
         }
+        update_plan();
     }
 
+    /// @brief Call \p func with the \ref ColDataRef of column \p idx.
+    /// \p func is instantiated for all the data types of the loader, which
+    /// include std::string_view only for \ref StringStorage::arena.
     template <tula::meta::IsUnary F>
     void visit_col(index_t idx, F &&func) {
         for (auto [i, data_col_idx] : m_ref_index[idx]) {
@@ -393,26 +622,79 @@ struct ECSVDataLoader {
     }
 
     void ensure_row_size_for_index(index_t idx) {
+        bool resized{false};
         for (const auto &array_data : m_array_data_refs) {
             std::visit(
-                [idx = idx](auto ref) {
-                    ref.get().ensure_row_size_for_index(idx);
+                [idx = idx, &resized](auto ref) {
+                    resized |= ref.get().ensure_row_size_for_index(idx);
                 },
                 array_data);
         }
+        if (resized) {
+            update_plan();
+        }
+    }
+    /// @brief Allocate all data to hold at least \p n rows.
+    void reserve(index_t n) {
+        bool resized{false};
+        for (const auto &array_data : m_array_data_refs) {
+            std::visit([n = n, &resized](
+                           auto ref) { resized |= ref.get().reserve(n); },
+                       array_data);
+        }
+        if (resized) {
+            update_plan();
+        }
     }
     void truncate(index_t size) {
         for (const auto &array_data : m_array_data_refs) {
             std::visit([size = size](auto ref) { ref.get().truncate(size); },
                        array_data);
         }
+        update_plan();
+    }
+
+    /// @brief Decode \p fields to row \p row_idx following the plan.
+    /// The row has to be allocated already.
+    template <typename Fields>
+    void decode_row(index_t row_idx, const Fields &fields) const {
+        for (const auto &p : m_plan) {
+            p.decode(fields[p.field_idx],
+                     p.data + static_cast<std::ptrdiff_t>(row_idx) * p.stride);
+        }
+        for (const auto &p : m_arena_plan) {
+            p.arena->set(row_idx, fields[p.field_idx]);
+        }
+        for (const auto &p : m_stats_plan) {
+            p.accumulate(p.data + static_cast<std::ptrdiff_t>(row_idx) *
+                                      p.stride,
+                         *p.stats);
+        }
     }
 
-    [[nodiscard]] auto get_ref_index() const -> decltype(auto) {
+    /// @brief Accumulate the statistics of the decoded numeric columns to
+    /// \p stats, indexed by the header column index. Pass nullptr to stop.
+    void set_stats(std::vector<ColumnStats> *stats) {
+        m_stats = stats;
+        update_plan();
+    }
+
+    [[nodiscard]] auto plan() const noexcept -> const plan_t & {
+        return m_plan;
+    }
+    [[nodiscard]] auto arena_plan() const noexcept -> const arena_plan_t & {
+        return m_arena_plan;
+    }
+    [[nodiscard]] auto stats_plan() const noexcept -> const stats_plan_t & {
+        return m_stats_plan;
+    }
+
+    [[nodiscard]] auto get_ref_index() const noexcept -> const auto & {
         return m_ref_index;
     }
 
-    [[nodiscard]] auto header_view() const -> decltype(auto) {
+    [[nodiscard]] auto header_view() const noexcept
+        -> const ECSVHeaderView & {
         return m_hdr_view;
     }
 
@@ -422,13 +704,73 @@ private:
     // This holds the list of index pairs to locate the data col for each
     // hdr col
     std::vector<std::vector<std::pair<index_t, index_t>>> m_ref_index;
+    // This holds the decoders and data locations ordered by hdr col, and
+    // has to be updated when the data are re-allocated
+    plan_t m_plan;
+    arena_plan_t m_arena_plan;
+    std::vector<ColumnStats> *m_stats{nullptr};
+    stats_plan_t m_stats_plan;
+
+    void update_plan() {
+        m_plan.clear();
+        m_arena_plan.clear();
+        m_stats_plan.clear();
+        for (index_t col_idx = 0; col_idx < m_ref_index.size(); ++col_idx) {
+            for (auto [i, data_col_idx] : m_ref_index[col_idx]) {
+                std::visit(
+                    [&, data_col_idx = data_col_idx](auto ref) {
+                        using array_data_t = std::decay_t<decltype(ref.get())>;
+                        using value_t = typename array_data_t::value_t;
+                        if constexpr (array_data_t::is_arena_data) {
+                            m_arena_plan.push_back(
+                                {col_idx, &ref.get()(data_col_idx).data});
+                        } else {
+                            auto [ptr, stride] =
+                                ref.get().col_data(data_col_idx);
+                            m_plan.push_back(
+                                {col_idx, field_decoder<value_t>(),
+                                 reinterpret_cast<std::byte *>(ptr), // NOLINT
+                                 stride * static_cast<std::ptrdiff_t>(
+                                              sizeof(value_t))});
+                            if (m_stats != nullptr &&
+                                has_column_stats<value_t>) {
+                                m_stats_plan.push_back(
+                                    {stats_accumulator<value_t>(),
+                                     m_plan.back().data, m_plan.back().stride,
+                                     &m_stats->at(col_idx)});
+                            }
+                        }
+                    },
+                    m_array_data_refs[i]);
+            }
+        }
+    }
+};
+
+/// @brief The storage of string columns in tables.
+enum class StringStorage {
+    string, ///< Each value is a std::string.
+    arena,  ///< Each column is a \ref StringArena, and the values are
+            ///< accessed as std::string_view.
+};
+
+/// @brief The layout of the data in tables.
+enum class TableLayout {
+    col_major, ///< Column-major storage. The rows are decoded directly to
+               ///< the columns.
+    row_major, ///< Row-major storage, for row-oriented consumers.
+    staged,    ///< Column-major storage. The rows are decoded to a small
+               ///< row-major staging buffer, which is transposed to the
+               ///< columns in cache-blocked tiles.
 };
 
 namespace internal {
-template <internal::ECSVDataType... Ts>
+template <Eigen::StorageOptions order, internal::ECSVDataType... Ts>
 struct table_data_traits_impl {
-    using value_t = std::tuple<ArrayData<Ts>...>;
-    using loader_t = ECSVDataLoader<ArrayData<Ts>...>;
+    template <internal::ECSVDataType T>
+    using array_data_t = ArrayData<T, array_data_block_size, order>;
+    using value_t = std::tuple<array_data_t<Ts>...>;
+    using loader_t = ECSVDataLoader<array_data_t<Ts>...>;
     using supported_dtypes_t = std::tuple<Ts...>;
 
     template <internal::ECSVDataType T>
@@ -436,96 +778,525 @@ struct table_data_traits_impl {
         return tula::meta::index_in_tuple<T, supported_dtypes_t>::value;
     }
 
+    /// @brief Call \p func with a default value of the type named
+    /// \p datatype. Returns false if the type is not supported.
+    template <typename F>
+    static auto visit_dtype(const std::string &datatype, F &&func) -> bool {
+        bool found{false};
+        auto visit = [&](auto value) {
+            if (!found && datatype == dtype_str<decltype(value)>()) {
+                found = true;
+                func(value);
+            }
+        };
+        (visit(Ts{}), ...);
+        return found;
+    }
+
     static auto init_value(const ECSVHeader &hdr) {
-        return value_t{ArrayData<Ts>(hdr, [](const auto &col) {
+        return value_t{array_data_t<Ts>(hdr, [](const auto &col) {
             return col.datatype == dtype_str<Ts>();
         })...};
     }
 
+    /// @brief Create the data for the columns in \p hdr_view only.
+    static auto init_value(const ECSVHeader &hdr,
+                           const ECSVHeaderView &hdr_view) {
+        auto is_selected = [&hdr_view](const auto &col) {
+            return std::ranges::find(hdr_view.colnames(), col.name) !=
+                   hdr_view.colnames().end();
+        };
+        return value_t{array_data_t<Ts>(hdr, [&is_selected](const auto &col) {
+            return col.datatype == dtype_str<Ts>() && is_selected(col);
+        })...};
+    }
+
     static auto init_loader(const ECSVHeader &hdr, value_t &value) {
-        return ECSVDataLoader(hdr, std::get<ArrayData<Ts>>(value)...);
+        return ECSVDataLoader(hdr, std::get<array_data_t<Ts>>(value)...);
+    }
+};
+
+/**
+ * @brief The index of the field text in the ECSV data section, to decode
+ * the columns lazily.
+ *
+ * The fields of the indexed columns are stored as the offset and size
+ * relative to the start of the row. Fields that are unescaped by the
+ * tokenizer are not in the buffer, and are marked to re-tokenize the row.
+ */
+struct LazyFieldIndex {
+    using index_t = std::size_t;
+    struct Field {
+        std::uint32_t offset{0};
+        std::uint32_t size{0};
+    };
+    constexpr static auto escaped = std::numeric_limits<std::uint32_t>::max();
+    constexpr static auto npos = std::numeric_limits<index_t>::max();
+
+    /// @brief Keeps the buffer alive.
+    std::shared_ptr<const void> holder{};
+    std::string_view buf{};
+    char delimiter{spec::ECSV_DELIM_CHAR};
+    /// @brief The slot of each header column, or npos if not indexed.
+    std::vector<index_t> slots{};
+    index_t n_slots{0};
+    std::vector<std::uint64_t> row_offsets{};
+    /// @brief The fields ordered by row then by slot.
+    std::vector<Field> fields{};
+
+    /// @brief Add row starting at \p row_offset with \p row_fields.
+    template <typename Fields>
+    void add_row(std::uint64_t row_offset, const Fields &row_fields) {
+        row_offsets.push_back(row_offset);
+        const auto *row_begin = buf.data() + row_offset;
+        const auto *buf_end = buf.data() + buf.size();
+        for (index_t j = 0; j < slots.size(); ++j) {
+            if (slots[j] == npos) {
+                continue;
+            }
+            auto field = row_fields[j];
+            if (field.empty()) {
+                fields.push_back({0, 0});
+            } else if (field.data() >= row_begin &&
+                       field.data() + field.size() <= buf_end &&
+                       std::uint64_t(field.data() - row_begin) < escaped &&
+                       field.size() < escaped) {
+                fields.push_back(
+                    {static_cast<std::uint32_t>(field.data() - row_begin),
+                     static_cast<std::uint32_t>(field.size())});
+            } else {
+                fields.push_back({0, escaped});
+            }
+        }
+    }
+
+    /// @brief Call \p func with the row index and the text of field
+    /// \p col_idx of each row.
+    template <typename F>
+    void visit_fields(index_t col_idx, F &&func) const {
+        auto slot = slots[col_idx];
+        ECSVTokenizer::fields_t row_fields;
+        for (index_t i = 0; i < row_offsets.size(); ++i) {
+            const auto &f = fields[i * n_slots + slot];
+            if (f.size == escaped) {
+                auto rows =
+                    ECSVTokenizer(buf.substr(row_offsets[i]), delimiter);
+                rows.next(row_fields);
+                func(i, row_fields[col_idx]);
+            } else {
+                func(i, buf.substr(row_offsets[i] + f.offset, f.size));
+            }
+        }
     }
 };
+
+/// @brief The type of the values of string columns stored in \p storage.
+template <StringStorage storage>
+using string_value_t = std::conditional_t<storage == StringStorage::arena,
+                                          std::string_view, std::string>;
+
+// bool, int8, int16, int32, int64
+// uint8, uint16, uint32, uint64
+// float16, float32, float64, float128
+// complex64, complex128, complex256
+// string
+template <Eigen::StorageOptions order,
+          StringStorage storage = StringStorage::string>
+using ecsv_table_data_traits = table_data_traits_impl<
+    order, bool, int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t,
+    uint32_t, uint64_t, float, double, long double, std::complex<float>,
+    std::complex<double>, std::complex<long double>,
+    string_value_t<storage>>;
+
 } // namespace internal
 
-struct ECSVTable {
+/// @brief ECSV table of which the data are stored in \p layout_, and the
+/// string columns in \p string_storage_.
+/// With \ref StringStorage::arena, the string columns are accessed with
+/// `col<std::string_view>`, which is the only string type of the table.
+template <TableLayout layout_ = TableLayout::col_major,
+          StringStorage string_storage_ = StringStorage::string>
+struct BasicECSVTable {
     using index_t = ECSVHeaderView::index_t;
     using label_t = ECSVHeaderView::label_t;
-    // bool, int8, int16, int32, int64
-    // uint8, uint16, uint32, uint64
-    // float16, float32, float64, float128
-    // complex64, complex128, complex256
-    using table_data_traits = internal::table_data_traits_impl<
-        bool, int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t, uint32_t,
-        uint64_t, float, double, long double, std::complex<float>,
-        std::complex<double>, std::complex<long double>, std::string>;
-    using table_data_t = table_data_traits::value_t;
-    using loader_t = table_data_traits::loader_t;
-
-    ECSVTable(ECSVHeader hdr)
-        : m_hdr{std::move(hdr)}, m_data{table_data_traits::init_value(m_hdr)},
-          m_loader{table_data_traits::init_loader(m_hdr, m_data)} {};
-
-    auto header() const -> decltype(auto) { return m_hdr; }
-    auto header_view() const -> decltype(auto) {
-        return m_loader.header_view();
-    }
-    auto loader() const -> decltype(auto) { return m_loader; }
+    constexpr static auto layout = layout_;
+    constexpr static auto storage_order = layout == TableLayout::row_major
+                                              ? Eigen::RowMajor
+                                              : Eigen::ColMajor;
+    using table_data_traits =
+        internal::ecsv_table_data_traits<storage_order, string_storage_>;
+    using table_data_t = typename table_data_traits::value_t;
+    using loader_t = typename table_data_traits::loader_t;
+    template <internal::ECSVDataType T>
+    using array_data_t = typename table_data_traits::template array_data_t<T>;
+    /// @brief The number of rows of the staging buffer of the staged
+    /// layout, which is also the row size of the tiles to transpose.
+    constexpr static std::size_t staging_rows = 256;
+
+    /// @brief Create table of all columns.
+    /// @param stats_policy With \ref ColumnStatsPolicy::collect, the
+    /// statistics of the numeric columns are accumulated when loading.
+    /// @see \ref stats.
+    BasicECSVTable(ECSVHeader hdr,
+                   ColumnStatsPolicy stats_policy = ColumnStatsPolicy::skip)
+        : m_hdr{std::make_unique<ECSVHeader>(std::move(hdr))},
+          m_hdr_view{*m_hdr},
+          m_data{table_data_traits::init_value(*m_hdr)},
+          m_loader{table_data_traits::init_loader(*m_hdr, m_data)},
+          m_stats_policy{stats_policy} {};
+
+    /// @brief Create table that loads columns \p colnames only.
+    /// The other columns are skipped when loading.
+    BasicECSVTable(ECSVHeader hdr, std::vector<label_t> colnames,
+                   ColumnStatsPolicy stats_policy = ColumnStatsPolicy::skip)
+        : m_hdr{std::make_unique<ECSVHeader>(std::move(hdr))},
+          m_hdr_view{*m_hdr, std::move(colnames)},
+          m_data{table_data_traits::init_value(*m_hdr, m_hdr_view)},
+          m_loader{table_data_traits::init_loader(*m_hdr, m_data)},
+          m_stats_policy{stats_policy} {};
+
+    /// @brief Create table that loads columns selected by \p pred only.
+    /// The other columns are skipped when loading.
+    template <typename Pred>
+    requires tula::meta::Invocable<Pred, const ECSVColumn &>
+    BasicECSVTable(ECSVHeader hdr, Pred &&pred,
+                   ColumnStatsPolicy stats_policy = ColumnStatsPolicy::skip)
+        : m_hdr{std::make_unique<ECSVHeader>(std::move(hdr))},
+          m_hdr_view{*m_hdr, std::forward<Pred>(pred)},
+          m_data{table_data_traits::init_value(*m_hdr, m_hdr_view)},
+          m_loader{table_data_traits::init_loader(*m_hdr, m_data)},
+          m_stats_policy{stats_policy} {};
+
+    // The array data refer to the header, which is held on the heap so it
+    // stays in place when the table is moved. The loader refers to the
+    // array data and is re-created.
+    BasicECSVTable(BasicECSVTable &&other)
+        : m_hdr{std::move(other.m_hdr)}, m_hdr_view{other.m_hdr_view},
+          m_data{std::move(other.m_data)},
+          m_loader{table_data_traits::init_loader(*m_hdr, m_data)},
+          m_current_rows{other.m_current_rows},
+          m_stats_policy{other.m_stats_policy},
+          m_stats{std::move(other.m_stats)}, m_lazy{std::move(other.m_lazy)},
+          m_lazy_cols{std::move(other.m_lazy_cols)} {
+        if (!m_stats.empty()) {
+            m_loader.set_stats(&m_stats);
+        }
+    }
+    BasicECSVTable(const BasicECSVTable &) = delete;
+    auto operator=(const BasicECSVTable &) -> BasicECSVTable & = delete;
+    auto operator=(BasicECSVTable &&) -> BasicECSVTable & = delete;
+    ~BasicECSVTable() = default;
+
+    /// @brief Create table from file by memory-mapping it.
+    /// The fields are parsed directly from the mapped bytes. Gzip-compressed
+    /// files are decompressed in blocks with \ref ECSVGzipRows.
+    /// @param projection Optional column names or predicate to select the
+    /// columns to load, and the stats policy.
+    template <typename... Projection>
+    static auto from_mmap(const std::string &filepath,
+                          Projection &&...projection) -> BasicECSVTable {
+        auto file = tula::mmap_utils::MappedFile(filepath);
+        file.advise(tula::mmap_utils::Advice::sequential);
+        auto buf = file.view();
+        if (internal::is_gzip(buf)) {
+#if TULA_ECSV_HAS_ZLIB
+            auto rows = ECSVGzipRows(buf);
+            auto tbl = BasicECSVTable(rows.header(),
+                                      std::forward<Projection>(projection)...);
+            tbl.load_rows(rows);
+            return tbl;
+#else
+            internal::throw_gzip_unsupported(filepath, "without zlib");
+#endif
+        }
+        std::size_t data_offset{0};
+        auto tbl = BasicECSVTable(ECSVHeader::read_view(buf, &data_offset),
+                                  std::forward<Projection>(projection)...);
+        auto data = buf.substr(data_offset);
+        auto rows = ECSVTokenizer(data, tbl.header().delimiter());
+        tbl.load_rows(rows, count_lines(data));
+        return tbl;
+    }
+
+    /// @brief Create table from file by memory-mapping it, and decode the
+    /// columns lazily.
+    /// The rows are only split to fields on load, and each column is
+    /// decoded on first access. The file stays mapped for the lifetime of
+    /// the table. Gzip-compressed files are not supported.
+    /// @see \ref load_rows_lazy.
+    template <typename... Projection>
+    static auto from_mmap_lazy(const std::string &filepath,
+                               Projection &&...projection) -> BasicECSVTable {
+        auto file = std::make_shared<tula::mmap_utils::MappedFile>(filepath);
+        file->advise(tula::mmap_utils::Advice::sequential);
+        auto buf = file->view();
+        if (internal::is_gzip(buf)) {
+            // the lazy columns refer to the text in the mapped file
+            internal::throw_gzip_unsupported(filepath,
+                                             "lazily, use from_mmap");
+        }
+        std::size_t data_offset{0};
+        auto tbl = BasicECSVTable(ECSVHeader::read_view(buf, &data_offset),
+                                  std::forward<Projection>(projection)...);
+        tbl.load_rows_lazy(buf.substr(data_offset), std::move(file));
+        return tbl;
+    }
+
+    auto header() const -> const ECSVHeader & { return *m_hdr; }
+    /// @brief The view of the loaded columns.
+    auto header_view() const -> const ECSVHeaderView & { return m_hdr_view; }
+    auto loader() const noexcept -> const loader_t & { return m_loader; }
+    constexpr static auto string_storage() noexcept -> StringStorage {
+        return string_storage_;
+    }
+    auto stats_policy() const noexcept -> ColumnStatsPolicy {
+        return m_stats_policy;
+    }
 
     template <internal::ECSVDataType T>
-    auto array_data() const -> decltype(auto) {
-        return std::get<ArrayData<T>>(m_data);
+    auto array_data() const -> const array_data_t<T> & {
+        materialize();
+        return std::get<array_data_t<T>>(m_data);
     }
     template <internal::ECSVDataType T>
     auto col(index_t idx) {
-        auto [i, j] = m_loader.get_ref_index()[idx].front();
-        return this->array_data<T>().array().col(j);
-        // auto colref = m_loader.colrefs(idx).front();
-        // because there is no duplicate in the loader, we can just get the
-        // first col
-        // unwrap the variant
-        // return std::get<decltype(std::declval<ArrayData<T> &>()(index_t()))>(
-        // colref);
+        return std::get<array_data_t<T>>(m_data)(data_col_index<T>(idx));
     }
     template <internal::ECSVDataType T>
     auto col(const label_t &name) -> decltype(auto) {
-        return col<T>(this->header_view().index(name));
+        return col<T>(m_loader.header_view().index(name));
+    }
+
+    /// @brief Return the map of the data of column \p idx.
+    /// No data are copied or allocated. The map refers to the storage of
+    /// the table, which stays in place when the table is moved, and is
+    /// valid until the table is resized or loaded.
+    template <internal::ECSVDataType T>
+    requires internal::use_eigen_array_data<T>
+    auto col_map(index_t idx) -> ColMap<T> {
+        auto [data, stride] =
+            std::get<array_data_t<T>>(m_data).col_data(data_col_index<T>(idx));
+        return {data, Eigen::Index(rows()), Eigen::InnerStride<>(stride)};
+    }
+    template <internal::ECSVDataType T>
+    requires internal::use_eigen_array_data<T>
+    auto col_map(index_t idx) const -> ConstColMap<T> {
+        auto [data, stride] =
+            std::get<array_data_t<T>>(m_data).col_data(data_col_index<T>(idx));
+        return {data, Eigen::Index(rows()), Eigen::InnerStride<>(stride)};
+    }
+    template <internal::ECSVDataType T>
+    requires internal::use_eigen_array_data<T>
+    auto col_map(const label_t &name) -> ColMap<T> {
+        return col_map<T>(m_loader.header_view().index(name));
+    }
+    template <internal::ECSVDataType T>
+    requires internal::use_eigen_array_data<T>
+    auto col_map(const label_t &name) const -> ConstColMap<T> {
+        return col_map<T>(m_loader.header_view().index(name));
+    }
+
+    /// @brief Return the span of the data of column \p idx.
+    /// This is as \ref col_map, and is available for the column-major
+    /// layouts and the string columns, of which the values are contiguous.
+    template <internal::ECSVDataType T>
+    requires(!internal::use_arena_array_data<T> &&
+             (layout != TableLayout::row_major ||
+              !internal::use_eigen_array_data<T>))
+    auto col_span(index_t idx) const -> std::span<const T> {
+        auto *data = std::get<array_data_t<T>>(m_data)
+                         .col_data(data_col_index<T>(idx))
+                         .first;
+        return {data, rows()};
+    }
+    template <internal::ECSVDataType T>
+    requires(!internal::use_arena_array_data<T> &&
+             (layout != TableLayout::row_major ||
+              !internal::use_eigen_array_data<T>))
+    auto col_span(const label_t &name) const -> std::span<const T> {
+        return col_span<T>(m_loader.header_view().index(name));
+    }
+
+    /// @brief Call \p func with the array data that holds column \p idx
+    /// and the index of the column in it.
+    /// Returns false if the column is not loaded.
+    template <typename F>
+    auto visit_array_data(index_t idx, F &&func) const -> bool {
+        const auto &refs = m_loader.get_ref_index().at(idx);
+        if (refs.empty()) {
+            return false;
+        }
+        auto [i, j] = refs.front();
+        ensure_decoded(idx);
+        tula::meta::static_for<std::size_t, 0,
+                               std::tuple_size_v<table_data_t>>([&](auto k) {
+            if (k == i) {
+                func(std::get<k>(m_data), j);
+            }
+        });
+        return true;
     }
 
-    auto cols() const -> std::size_t { return m_hdr.size(); }
+    /// @brief The number of loaded columns.
+    auto cols() const -> std::size_t { return m_hdr_view.size(); }
     auto rows() const -> std::size_t { return m_current_rows; }
     auto empty() const -> bool { return rows() == 0; }
 
+    /// @brief Resize the table to have \p n_rows rows.
+    /// The values in the new rows are unspecified and are to be set via
+    /// \ref col. The collected statistics are dropped.
+    void resize(std::size_t n_rows) {
+        materialize();
+        m_stats.clear();
+        m_loader.set_stats(nullptr);
+        m_loader.truncate(n_rows);
+        m_current_rows = n_rows;
+    }
+
+    /// @brief Load data from \p rows.
+    /// @param n_rows_hint The expected number of rows, e.g., counted from
+    /// the newlines in a pre-scan. When set, the data are allocated once
+    /// for this number of rows.
     template <tula::meta::Iterable It>
-    void load_rows(It &rows) {
+    void load_rows(It &rows, std::size_t n_rows_hint = 0) {
+        load_rows_impl(rows, n_rows_hint,
+                       [](const auto & /*row*/) { return true; });
+    }
+    /// @brief Load data of the rows selected by \p filter from \p rows.
+    /// Only the key fields are decoded for the rows that are dropped.
+    /// @param n_rows_hint The expected number of selected rows.
+    template <tula::meta::Iterable It, RowFilter Filter>
+    void load_rows(It &rows, const Filter &filter,
+                   std::size_t n_rows_hint = 0) {
+        load_rows_impl(rows, n_rows_hint, filter.bind(*m_hdr));
+    }
+    /// @brief Load rows from \p tables of the same columns, in order.
+    /// The rows are moved from \p tables, and the storage is allocated once
+    /// for the total number of rows.
+    template <std::ranges::range Tables>
+    void load_tables(Tables &&tables) {
         if (!empty()) {
             throw std::runtime_error(fmt::format(
                 "table already contains data n_rows={}", m_current_rows));
         }
-        int row_idx = 0;
-        for (const auto &row : rows) {
-            // populate data
-            m_loader.ensure_row_size_for_index(row_idx);
-            auto row_size = row.size();
-            if (row_size != this->cols()) {
+        std::size_t n_rows = 0;
+        for (const BasicECSVTable &t : tables) {
+            if (!m_hdr->is_compatible(t.header()) ||
+                t.header_view().colnames() != header_view().colnames()) {
                 throw std::runtime_error(fmt::format(
-                    "inconsistent number of fields at row {}: {} != {}",
-                    row_idx, row_size, this->cols()));
+                    "incompatible table columns [{}] != [{}]",
+                    fmt::join(t.header().cols(), ", "),
+                    fmt::join(m_hdr->cols(), ", ")));
             }
-            for (std::size_t col_idx = 0; col_idx < row_size; ++col_idx) {
-                m_loader.visit_col(
-                    col_idx, [&row_idx, &col_idx, &row](auto colref) {
-                        using value_t = typename decltype(colref)::value_t;
-                        value_t value;
-                        std::istringstream(row.at(col_idx)) >> value;
-                        colref.set_value(row_idx, value);
-                    });
+            n_rows += t.rows();
+        }
+        reset_stats();
+        if (n_rows == 0) {
+            return;
+        }
+        // exact size, so that the truncate below does not re-allocate
+        m_loader.reserve(n_rows);
+        std::size_t offset = 0;
+        for (BasicECSVTable &t : tables) {
+            t.materialize();
+            if (!m_stats.empty()) {
+                for (auto idx : m_hdr_view.indices()) {
+                    if (t.m_stats.empty()) {
+                        t.accumulate_stats(idx, m_stats[idx]);
+                    } else {
+                        m_stats[idx].merge(t.m_stats[idx]);
+                    }
+                }
             }
-            ++row_idx;
+            tula::meta::static_for<std::size_t, 0,
+                                   std::tuple_size_v<table_data_t>>(
+                [&](auto i) {
+                    std::get<i>(m_data).assign_rows(
+                        offset, std::move(std::get<i>(t.m_data)));
+                });
+            offset += t.rows();
         }
-        m_loader.truncate(row_idx);
-        m_current_rows = row_idx;
+        m_loader.truncate(n_rows);
+        m_current_rows = n_rows;
+    }
+
+    /// @brief Index the rows in \p buf for lazy decoding.
+    /// The fields of the loaded columns are located but not decoded. Each
+    /// column is decoded to the array data on the first call of \ref col,
+    /// \ref array_data or \ref visit_array_data, memoized with
+    /// tula::nddata::CachedData.
+    /// @param holder Keeps \p buf alive, if not owned by the caller.
+    void load_rows_lazy(std::string_view buf,
+                        std::shared_ptr<const void> holder = nullptr) {
+        if (!empty()) {
+            throw std::runtime_error(fmt::format(
+                "table already contains data n_rows={}", m_current_rows));
+        }
+        reset_stats();
+        auto lazy = std::make_unique<internal::LazyFieldIndex>();
+        lazy->holder = std::move(holder);
+        lazy->buf = buf;
+        lazy->delimiter = m_hdr->delimiter();
+        lazy->slots.resize(m_hdr->size(), internal::LazyFieldIndex::npos);
+        for (auto idx : m_hdr_view.indices()) {
+            lazy->slots[idx] = lazy->n_slots++;
+        }
+        auto n_rows_hint = count_lines(buf);
+        lazy->row_offsets.reserve(n_rows_hint);
+        lazy->fields.reserve(n_rows_hint * lazy->n_slots);
+        auto rows = ECSVTokenizer(buf, lazy->delimiter);
+        ECSVTokenizer::fields_t fields;
+        while (true) {
+            auto row_offset = rows.pos();
+            if (!rows.next(fields)) {
+                break;
+            }
+            if (fields.size() != m_hdr->size()) {
+                throw RowParseError(
+                    fmt::format("inconsistent number of fields {} != {}",
+                                fields.size(), m_hdr->size()),
+                    lazy->row_offsets.size());
+            }
+            lazy->add_row(row_offset, fields);
+        }
+        auto n_rows = lazy->row_offsets.size();
+        m_loader.truncate(n_rows);
+        m_current_rows = n_rows;
+        m_lazy_cols = lazy_cols_t(m_hdr->size());
+        m_lazy = std::move(lazy);
+    }
+
+    /// @brief Return true if the table has columns to decode lazily.
+    auto is_lazy() const noexcept -> bool { return m_lazy != nullptr; }
+
+    /// @brief Decode all columns of lazy table.
+    void materialize() const {
+        if (!is_lazy()) {
+            return;
+        }
+        for (auto idx : m_hdr_view.indices()) {
+            ensure_decoded(idx);
+        }
+    }
+
+    /// @brief Return the statistics of numeric column \p idx.
+    /// These are the ones accumulated when loading with
+    /// \ref ColumnStatsPolicy::collect, or computed from the data otherwise.
+    /// Changes made via \ref col after loading are not reflected in the
+    /// collected statistics.
+    auto stats(index_t idx) const -> ColumnStats {
+        ColumnStats result{};
+        if (!accumulate_stats(idx, result)) {
+            throw std::runtime_error(
+                fmt::format("column {} is not loaded or not numeric",
+                            m_hdr->cols().at(idx).name));
+        }
+        return result;
     }
+    auto stats(const label_t &name) const -> ColumnStats {
+        return stats(m_loader.header_view().index(name));
+    }
+
     auto info() -> std::string {
         std::stringstream ss;
         ss << fmt::format("ECSVTable n_cols={} n_rows={}\n", this->cols(),
@@ -547,16 +1318,236 @@ struct ECSVTable {
                 (..., get_array_data_info(array_data));
             },
             m_data);
+        if (!m_stats.empty()) {
+            ss << "Column Stats:\n";
+            for (auto idx : m_hdr_view.indices()) {
+                const auto &col = m_hdr->cols()[idx];
+                const auto &s = m_stats[idx];
+                table_data_traits::visit_dtype(col.datatype, [&](auto value) {
+                    if constexpr (has_column_stats<decltype(value)>) {
+                        // columns of lazy table are not decoded yet
+                        if (s.count + s.nan_count < rows()) {
+                            ss << fmt::format("{:>10s}: not decoded\n",
+                                              col.name);
+                        } else {
+                            ss << fmt::format("{:>10s}: {}\n", col.name, s);
+                        }
+                    }
+                });
+            }
+        }
         return ss.str();
     }
 
 private:
-    ECSVHeader m_hdr;
+    std::unique_ptr<ECSVHeader> m_hdr;
+    ECSVHeaderView m_hdr_view;
     table_data_t m_data;
     loader_t m_loader;
     std::size_t m_current_rows{0};
+    ColumnStatsPolicy m_stats_policy{ColumnStatsPolicy::skip};
+    /// @brief The statistics collected when loading, indexed by the header
+    /// column index. Empty if not collected.
+    std::vector<ColumnStats> m_stats{};
+
+    /// @brief Clear the statistics to collect, if enabled.
+    void reset_stats() {
+        if (m_stats_policy == ColumnStatsPolicy::collect) {
+            m_stats.assign(m_hdr->size(), ColumnStats{});
+            m_loader.set_stats(&m_stats);
+        }
+    }
+
+    /// @brief Add the statistics of column \p idx to \p stats.
+    /// Returns false if the column is not loaded or not numeric.
+    auto accumulate_stats(index_t idx, ColumnStats &stats) const -> bool {
+        bool is_numeric{false};
+        bool is_loaded = visit_array_data(idx, [&](const auto &array_data,
+                                                   auto j) {
+            using value_t = typename TULA_DECAY(array_data)::value_t;
+            if constexpr (has_column_stats<value_t>) {
+                is_numeric = true;
+                if (!m_stats.empty()) {
+                    stats.merge(m_stats[idx]);
+                    return;
+                }
+                auto [data, stride] = array_data.col_data(j);
+                for (std::size_t i = 0; i < rows(); ++i) {
+                    stats.add(data[static_cast<std::ptrdiff_t>(i) * stride]);
+                }
+            }
+        });
+        return is_loaded && is_numeric;
+    }
+
+    struct lazy_col_evaluator {
+        using parent_t = std::pair<const BasicECSVTable *, index_t>;
+        /// @brief Decode column parent.second following the loader plan.
+        /// The data are allocated on load so the plan is not changed.
+        static auto evaluate(const parent_t &parent) -> bool {
+            const auto &[tbl, idx] = parent;
+            const auto &loader = tbl->m_loader;
+            for (const auto &p : loader.plan()) {
+                if (p.field_idx != idx) {
+                    continue;
+                }
+                // accumulate the statistics while decoding, if collected
+                auto sp = std::find_if(
+                    loader.stats_plan().begin(), loader.stats_plan().end(),
+                    [&p](const auto &s) { return s.data == p.data; });
+                if (sp == loader.stats_plan().end()) {
+                    tbl->m_lazy->visit_fields(idx, [&p](auto i, auto field) {
+                        p.decode(field,
+                                 p.data + static_cast<std::ptrdiff_t>(i) *
+                                              p.stride);
+                    });
+                    continue;
+                }
+                tbl->m_lazy->visit_fields(idx, [&p, &sp](auto i, auto field) {
+                    auto *dest = p.data + static_cast<std::ptrdiff_t>(i) *
+                                              p.stride;
+                    p.decode(field, dest);
+                    sp->accumulate(dest, *sp->stats);
+                });
+            }
+            for (const auto &p : loader.arena_plan()) {
+                if (p.field_idx != idx) {
+                    continue;
+                }
+                tbl->m_lazy->visit_fields(idx, [&p](auto i, auto field) {
+                    p.arena->set(i, field);
+                });
+            }
+            return true;
+        }
+    };
+    using lazy_cols_t = std::vector<
+        tula::nddata::CachedData<bool, &lazy_col_evaluator::evaluate>>;
+    std::unique_ptr<internal::LazyFieldIndex> m_lazy{};
+    /// @brief The decoded state of each header column of lazy table.
+    lazy_cols_t m_lazy_cols{};
+
+    /// @brief Return the index of column \p idx in the array data of type
+    /// \p T, with the column decoded.
+    template <internal::ECSVDataType T>
+    auto data_col_index(index_t idx) const -> index_t {
+        // because there is no duplicate in the loader, we can just get the
+        // first col
+        const auto &refs = m_loader.get_ref_index().at(idx);
+        if (refs.empty()) {
+            throw std::runtime_error(fmt::format("column {} is not loaded",
+                                                 m_hdr->cols()[idx].name));
+        }
+        auto [i, j] = refs.front();
+        if (i != table_data_traits::template dtype_index<T>()) {
+            throw std::runtime_error(
+                fmt::format("column {} is not of type {}",
+                            m_hdr->cols()[idx].name, dtype_str<T>()));
+        }
+        ensure_decoded(idx);
+        return j;
+    }
+
+    void ensure_decoded(index_t idx) const {
+        if (!is_lazy()) {
+            return;
+        }
+        auto parent = typename lazy_col_evaluator::parent_t{this, idx};
+        m_lazy_cols[idx](parent);
+    }
+
+    template <tula::meta::Iterable It, typename Keep>
+    void load_rows_impl(It &rows, std::size_t n_rows_hint, Keep &&keep) {
+        if (!empty()) {
+            throw std::runtime_error(fmt::format(
+                "table already contains data n_rows={}", m_current_rows));
+        }
+        reset_stats();
+        m_loader.reserve(n_rows_hint);
+        if constexpr (layout == TableLayout::staged) {
+            load_rows_staged(rows, keep);
+            return;
+        }
+        index_t row_idx = 0;
+        index_t n_read = 0;
+        for (const auto &row : rows) {
+            auto row_size = row.size();
+            if (row_size != m_hdr->size()) {
+                throw RowParseError(
+                    fmt::format("inconsistent number of fields {} != {}",
+                                row_size, m_hdr->size()),
+                    n_read);
+            }
+            ++n_read;
+            if (!keep(row)) {
+                continue;
+            }
+            // populate data
+            m_loader.ensure_row_size_for_index(row_idx);
+            m_loader.decode_row(row_idx, row);
+            ++row_idx;
+        }
+        m_loader.truncate(row_idx);
+        m_current_rows = row_idx;
+    }
+
+    /// @brief Load \p rows by decoding to the row-major staging buffer and
+    /// transposing to the column-major data when it is full.
+    template <tula::meta::Iterable It, typename Keep>
+    void load_rows_staged(It &rows, Keep &keep) {
+        using staging_traits =
+            internal::ecsv_table_data_traits<Eigen::RowMajor,
+                                             string_storage_>;
+        auto staging = staging_traits::init_value(*m_hdr, m_hdr_view);
+        auto staging_loader = staging_traits::init_loader(*m_hdr, staging);
+        if (!m_stats.empty()) {
+            staging_loader.set_stats(&m_stats);
+        }
+        staging_loader.truncate(staging_rows);
+        index_t row_idx = 0;
+        index_t n_read = 0;
+        index_t n_staged = 0;
+        auto flush = [&]() {
+            m_loader.ensure_row_size_for_index(row_idx - 1);
+            tula::meta::static_for<std::size_t, 0,
+                                   std::tuple_size_v<table_data_t>>(
+                [&](auto i) {
+                    std::get<i>(m_data).assign_rows(
+                        row_idx - n_staged, std::get<i>(staging), n_staged);
+                });
+            n_staged = 0;
+        };
+        for (const auto &row : rows) {
+            auto row_size = row.size();
+            if (row_size != m_hdr->size()) {
+                throw RowParseError(
+                    fmt::format("inconsistent number of fields {} != {}",
+                                row_size, m_hdr->size()),
+                    n_read);
+            }
+            ++n_read;
+            if (!keep(row)) {
+                continue;
+            }
+            staging_loader.decode_row(n_staged, row);
+            ++row_idx;
+            if (++n_staged == staging_rows) {
+                flush();
+            }
+        }
+        if (n_staged > 0) {
+            flush();
+        }
+        m_loader.truncate(row_idx);
+        m_current_rows = row_idx;
+    }
 };
 
+using ECSVTable = BasicECSVTable<>;
+/// @brief ECSV table of which the string columns are stored in arenas.
+using ECSVArenaTable =
+    BasicECSVTable<TableLayout::col_major, StringStorage::arena>;
+
 } // namespace tula::ecsv
 
 namespace fmt {
@@ -598,18 +1589,19 @@ struct formatter<tula::ecsv::ECSVDataLoader<Ts...>>
     : tula::fmt_utils::nullspec_formatter_base {
     template <typename FormatContext>
     auto format(const tula::ecsv::ECSVDataLoader<Ts...> &loader,
-                FormatContext &ctx) {
+                FormatContext &ctx) const {
         auto it = ctx.out();
         return format_to(it, "ECSVDataLoader(n_cols={})",
                          loader.get_ref_index().size());
     }
 };
 
-template <>
-struct formatter<tula::ecsv::ECSVTable>
+template <tula::ecsv::TableLayout layout, tula::ecsv::StringStorage storage>
+struct formatter<tula::ecsv::BasicECSVTable<layout, storage>>
     : tula::fmt_utils::nullspec_formatter_base {
     template <typename FormatContext>
-    auto format(const tula::ecsv::ECSVTable &tbl, FormatContext &ctx) const {
+    auto format(const tula::ecsv::BasicECSVTable<layout, storage> &tbl,
+                FormatContext &ctx) const {
         auto it = ctx.out();
         return format_to(it, "ECSVTable(n_cols={})", tbl.header().size());
     }
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "core.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <fmt/core.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define TULA_ECSV_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace tula::ecsv {
+
+namespace internal {
+
+/// @brief The number of bytes classified at a time.
+constexpr std::size_t classify_block_size = 64;
+
+/// @brief The bitmasks of a classified block, with bit i for byte i.
+struct BlockMasks {
+    std::uint64_t field_end{0}; ///< The delimiters and newlines.
+    std::uint64_t quote{0};     ///< The quote chars.
+
+    auto operator==(const BlockMasks &) const -> bool = default;
+};
+
+/// @brief The function to classify a block of bytes.
+/// The carriage returns are not classified, as they are only stripped
+/// from the end of fields.
+using classify_t = BlockMasks (*)(const char *, char) noexcept;
+
+inline auto classify_scalar(const char *p, char delim) noexcept
+    -> BlockMasks {
+    BlockMasks masks{};
+    for (std::size_t i = 0; i < classify_block_size; ++i) {
+        masks.field_end |= std::uint64_t(p[i] == delim || p[i] == '\n') << i;
+        masks.quote |= std::uint64_t(p[i] == '"') << i;
+    }
+    return masks;
+}
+
+#ifdef TULA_ECSV_X86_SIMD
+__attribute__((target("sse2"))) inline auto
+classify_sse2(const char *p, char delim) noexcept -> BlockMasks {
+    const auto vd = _mm_set1_epi8(delim);
+    const auto vn = _mm_set1_epi8('\n');
+    const auto vq = _mm_set1_epi8('"');
+    BlockMasks masks{};
+    for (std::size_t i = 0; i < classify_block_size; i += 16) {
+        auto v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(p + i)); // NOLINT
+        auto m = _mm_or_si128(_mm_cmpeq_epi8(v, vd), _mm_cmpeq_epi8(v, vn));
+        auto bits = static_cast<std::uint16_t>(_mm_movemask_epi8(m));
+        auto qbits = static_cast<std::uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)));
+        masks.field_end |= std::uint64_t(bits) << i;
+        masks.quote |= std::uint64_t(qbits) << i;
+    }
+    return masks;
+}
+
+__attribute__((target("avx2"))) inline auto
+classify_avx2(const char *p, char delim) noexcept -> BlockMasks {
+    const auto vd = _mm256_set1_epi8(delim);
+    const auto vn = _mm256_set1_epi8('\n');
+    const auto vq = _mm256_set1_epi8('"');
+    BlockMasks masks{};
+    for (std::size_t i = 0; i < classify_block_size; i += 32) {
+        auto v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(p + i)); // NOLINT
+        auto m = _mm256_or_si256(_mm256_cmpeq_epi8(v, vd),
+                                 _mm256_cmpeq_epi8(v, vn));
+        auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+        auto qbits = static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vq)));
+        masks.field_end |= std::uint64_t(bits) << i;
+        masks.quote |= std::uint64_t(qbits) << i;
+    }
+    return masks;
+}
+#endif
+
+/// @brief Return the name and the classify function of the best
+/// instruction set supported by the CPU.
+inline auto dispatch_classify() noexcept
+    -> std::pair<std::string_view, classify_t> {
+#ifdef TULA_ECSV_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", &classify_avx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {"sse2", &classify_sse2};
+    }
+#endif
+    return {"scalar", &classify_scalar};
+}
+
+/// @brief The classify function selected at startup.
+inline const auto default_classify = dispatch_classify();
+
+} // namespace internal
+
+/**
+ * @brief Split the ECSV data section held in contiguous memory to fields.
+ *
+ * The fields are views into the buffer so no copy is made, except for
+ * quoted fields that contain escaped quotes (""). These are unescaped to an
+ * internal buffer that is valid until the next row is read. Blank lines are
+ * skipped, and both LF and CRLF line endings are accepted.
+ */
+struct ECSVTokenizer {
+    using fields_t = std::vector<std::string_view>;
+    static constexpr char quote_char = '"';
+
+    ECSVTokenizer(std::string_view buf,
+                  char delimiter = spec::ECSV_DELIM_CHAR,
+                  internal::classify_t classify =
+                      internal::default_classify.second) noexcept
+        : m_buf{buf}, m_delim{delimiter}, m_classify{classify} {}
+
+    /// @brief Read the next row to \p fields. Returns false if no more rows.
+    auto next(fields_t &fields) -> bool {
+        fields.clear();
+        m_scratch.clear();
+        // skip blank lines
+        while (m_pos < m_buf.size() &&
+               (m_buf[m_pos] == '\n' || m_buf[m_pos] == '\r')) {
+            ++m_pos;
+        }
+        if (m_pos >= m_buf.size()) {
+            return false;
+        }
+        while (true) {
+            auto [field, end] = (m_buf[m_pos] == quote_char)
+                                    ? scan_quoted(m_pos)
+                                    : scan_unquoted(m_pos);
+            fields.push_back(field);
+            if (end >= m_buf.size()) {
+                m_pos = m_buf.size();
+                return true;
+            }
+            m_pos = end + 1;
+            if (m_buf[end] == '\n') {
+                return true;
+            }
+            // got delimiter, check for trailing empty field
+            if (m_pos >= m_buf.size() || m_buf[m_pos] == '\n' ||
+                m_buf[m_pos] == '\r') {
+                fields.emplace_back();
+                // consume the line ending
+                while (m_pos < m_buf.size() && m_buf[m_pos] != '\n') {
+                    ++m_pos;
+                }
+                ++m_pos;
+                return true;
+            }
+        }
+    }
+
+    /// @brief The offset of the next byte to read.
+    auto pos() const noexcept -> std::size_t { return m_pos; }
+
+    struct iterator {
+        ECSVTokenizer *tokenizer{nullptr};
+        fields_t fields{};
+        bool done{true};
+
+        auto operator*() const noexcept -> const fields_t & { return fields; }
+        auto operator->() const noexcept -> const fields_t * {
+            return &fields;
+        }
+        auto operator++() -> iterator & {
+            done = !tokenizer->next(fields);
+            return *this;
+        }
+        auto operator==(const iterator &other) const noexcept -> bool {
+            return done == other.done;
+        }
+    };
+    auto begin() -> iterator {
+        iterator it{this};
+        ++it;
+        return it;
+    }
+    auto end() -> iterator { return iterator{this}; }
+
+private:
+    std::string_view m_buf;
+    char m_delim;
+    internal::classify_t m_classify;
+    std::size_t m_pos{0};
+    std::deque<std::string> m_scratch{};
+    // the classified block that starts at m_block_pos
+    std::size_t m_block_pos{std::string_view::npos};
+    internal::BlockMasks m_block{};
+
+    using scan_result_t = std::pair<std::string_view, std::size_t>;
+
+    /// @brief Return the masks of block at \p block_pos.
+    auto classify_block(std::size_t block_pos) const noexcept
+        -> internal::BlockMasks {
+        constexpr auto n = internal::classify_block_size;
+        if (block_pos + n <= m_buf.size()) {
+            return m_classify(m_buf.data() + block_pos, m_delim);
+        }
+        // the tail is copied to a padded block
+        char tail[n]{}; // NOLINT(modernize-avoid-c-arrays)
+        m_buf.copy(tail, m_buf.size() - block_pos, block_pos);
+        auto masks = internal::classify_scalar(tail, m_delim);
+        auto valid = (std::uint64_t(1) << (m_buf.size() - block_pos)) - 1;
+        masks.field_end &= valid;
+        masks.quote &= valid;
+        return masks;
+    }
+
+    /// @brief Return the position of the first byte at or after \p pos
+    /// that is set in the block mask \p Mask, or the buffer size if there
+    /// is none.
+    template <std::uint64_t internal::BlockMasks::*Mask>
+    auto find_next(std::size_t pos) noexcept -> std::size_t {
+        constexpr auto n = internal::classify_block_size;
+        auto block_pos = pos / n * n;
+        if (block_pos != m_block_pos) {
+            m_block_pos = block_pos;
+            m_block = classify_block(block_pos);
+        }
+        auto mask = m_block.*Mask & (~std::uint64_t(0) << (pos - block_pos));
+        while (mask == 0) {
+            m_block_pos += n;
+            if (m_block_pos >= m_buf.size()) {
+                return m_buf.size();
+            }
+            m_block = classify_block(m_block_pos);
+            mask = m_block.*Mask;
+        }
+        return m_block_pos + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+
+    /// @brief Return the position of the first delimiter or newline at or
+    /// after \p pos, or the buffer size if there is none.
+    auto find_field_end(std::size_t pos) noexcept -> std::size_t {
+        return find_next<&internal::BlockMasks::field_end>(pos);
+    }
+
+    /// @brief Return the position of the first quote char at or after
+    /// \p pos, or the buffer size if there is none.
+    auto find_quote(std::size_t pos) noexcept -> std::size_t {
+        return find_next<&internal::BlockMasks::quote>(pos);
+    }
+
+    /// @brief Scan field starting at \p pos until delimiter or newline.
+    /// Returns the field and the position of the terminating char.
+    auto scan_unquoted(std::size_t pos) noexcept -> scan_result_t {
+        if (pos >= m_buf.size()) {
+            return {{}, m_buf.size()};
+        }
+        auto end = find_field_end(pos);
+        auto field = m_buf.substr(pos, end - pos);
+        if (!field.empty() && field.back() == '\r') {
+            field.remove_suffix(1);
+        }
+        return {field, end};
+    }
+
+    /// @brief Scan quoted field starting at the quote char at \p pos.
+    auto scan_quoted(std::size_t pos) -> scan_result_t {
+        auto begin = pos + 1;
+        auto cur = begin;
+        bool escaped{false};
+        std::size_t close{0};
+        while (true) {
+            close = find_quote(cur);
+            if (close >= m_buf.size()) {
+                throw ParseError(fmt::format(
+                    "unterminated quoted field at offset {}", pos));
+            }
+            if (close + 1 < m_buf.size() && m_buf[close + 1] == quote_char) {
+                escaped = true;
+                cur = close + 2;
+                continue;
+            }
+            break;
+        }
+        auto field = m_buf.substr(begin, close - begin);
+        if (escaped) {
+            auto &s = m_scratch.emplace_back();
+            s.reserve(field.size());
+            for (std::size_t i = 0; i < field.size(); ++i) {
+                s.push_back(field[i]);
+                if (field[i] == quote_char) {
+                    ++i;
+                }
+            }
+            field = s;
+        }
+        // skip anything between the closing quote and the terminator
+        auto [_, end] = scan_unquoted(close + 1);
+        return {field, end};
+    }
+};
+
+/// @brief Return the number of lines in \p buf.
+/// This is an upper bound of the number of rows and can be used as the
+/// row count hint for loading.
+inline auto count_lines(std::string_view buf) noexcept -> std::size_t {
+    if (buf.empty()) {
+        return 0;
+    }
+    auto n =
+        static_cast<std::size_t>(std::count(buf.begin(), buf.end(), '\n'));
+    return buf.back() == '\n' ? n : n + 1;
+}
+
+} // namespace tula::ecsv
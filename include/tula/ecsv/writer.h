@@ -0,0 +1,237 @@
+#pragma once
+
+#include "../grppi.h"
+#include "../logging.h"
+#include "encoder.h"
+#include "table.h"
+#include <numeric>
+#include <ostream>
+#include <thread>
+
+namespace tula::ecsv {
+
+/**
+ * @brief Write ECSV header and data to stream.
+ *
+ * The rows are formatted to a reusable buffer which is written to the
+ * stream when it is full. When the GRPPI execution mode is not "seq", row
+ * ranges are formatted to per-task buffers in parallel and written in
+ * order.
+ */
+struct ECSVWriter {
+    using index_t = std::size_t;
+    constexpr static std::size_t default_buffer_size = 1 << 22;
+    /// @brief The number of rows formatted by each task in parallel mode.
+    constexpr static std::size_t parallel_chunk_rows = 1 << 14;
+
+    /// @brief The entry of the encode plan.
+    /// It encodes the value at \p data + row_idx * \p stride, or the value
+    /// at row_idx of \p arena if it is set.
+    struct PlanEntry {
+        field_encoder_t encode;
+        const std::byte *data;
+        std::ptrdiff_t stride;
+        const StringArena *arena{nullptr};
+    };
+    using plan_t = std::vector<PlanEntry>;
+
+    ECSVWriter(std::ostream &os, std::string_view ex_mode = "seq",
+               std::size_t buffer_size = default_buffer_size)
+        : m_os{os}, m_ex_mode{ex_mode}, m_buffer_size{buffer_size} {
+        m_buf.reserve(m_buffer_size);
+    }
+    ECSVWriter(const ECSVWriter &) = delete;
+    ECSVWriter(ECSVWriter &&) = delete;
+    auto operator=(const ECSVWriter &) -> ECSVWriter & = delete;
+    auto operator=(ECSVWriter &&) -> ECSVWriter & = delete;
+    ~ECSVWriter() { flush(); }
+
+    /// @brief Write the YAML header and the CSV header line.
+    /// The column names are quoted in the CSV header line as the string
+    /// values.
+    void write_header(const ECSVHeader &hdr) {
+        m_delimiter = hdr.delimiter();
+        std::stringstream ss;
+        spec::dump_yaml_header(ss, hdr.to_node());
+        m_buf.append(ss.str());
+        for (std::size_t i = 0; i < hdr.size(); ++i) {
+            if (i > 0) {
+                m_buf.push_back(m_delimiter);
+            }
+            internal::encode_string(m_buf, hdr.cols()[i].name);
+        }
+        m_buf.push_back('\n');
+    }
+
+    /// @brief Write the loaded columns of table \p tbl.
+    template <TableLayout layout, StringStorage string_storage>
+    void write(const BasicECSVTable<layout, string_storage> &tbl) {
+        const auto &hdr = tbl.header();
+        if (tbl.cols() == hdr.size()) {
+            write_header(hdr);
+        } else {
+            write_header(ECSVHeader(
+                tula::container_utils::to_stdvec(tbl.header_view().cols()),
+                hdr.meta(), hdr.delimiter(), hdr.schema(),
+                hdr.spec_version()));
+        }
+        write_rows(make_plan(tbl), tbl.rows());
+    }
+
+    /// @brief Write Eigen column blocks \p blocks as table.
+    /// Each column of the blocks is a column of the table.
+    /// @param colnames The column names of all blocks.
+    /// @param meta The metadata to include in the header.
+    template <typename... Derived>
+    void write(const std::vector<std::string> &colnames,
+               const YAML::Node &meta,
+               const Eigen::DenseBase<Derived> &...blocks) {
+        std::vector<ECSVColumn> cols;
+        plan_t plan;
+        std::vector<index_t> n_rows{index_t(blocks.rows())...};
+        if (std::adjacent_find(n_rows.begin(), n_rows.end(),
+                               std::not_equal_to<>()) != n_rows.end()) {
+            throw DumpError(
+                fmt::format("mismatch number of rows in blocks {}", n_rows));
+        }
+        auto add_block = [&]<typename D>(const Eigen::DenseBase<D> &block) {
+            using value_t = typename D::Scalar;
+            static_assert(bool(D::Flags & Eigen::DirectAccessBit),
+                          "BLOCK HAS TO BE DIRECT ACCESSIBLE");
+            for (Eigen::Index j = 0; j < block.cols(); ++j) {
+                auto i = cols.size();
+                if (i >= colnames.size()) {
+                    break;
+                }
+                cols.push_back({colnames[i], dtype_str<value_t>()});
+                auto data_col = block.derived().col(j);
+                plan.push_back(
+                    {field_encoder<value_t>(),
+                     reinterpret_cast<const std::byte *>( // NOLINT
+                         data_col.data()),
+                     data_col.innerStride() *
+                         static_cast<std::ptrdiff_t>(sizeof(value_t)),
+                     nullptr});
+            }
+        };
+        (add_block(blocks), ...);
+        if (cols.size() != colnames.size() ||
+            colnames.size() != (index_t(blocks.cols()) + ... + 0)) {
+            throw DumpError(fmt::format(
+                "mismatch number of colnames {} with number of columns {}",
+                colnames.size(), (index_t(blocks.cols()) + ... + 0)));
+        }
+        write_header(ECSVHeader(std::move(cols), meta, spec::ECSV_DELIM_CHAR,
+                                std::nullopt, std::nullopt));
+        write_rows(plan, n_rows.empty() ? 0 : n_rows.front());
+    }
+
+    /// @brief Write \p n_rows rows following \p plan.
+    void write_rows(const plan_t &plan, std::size_t n_rows) {
+        if (plan.empty() || n_rows == 0) {
+            return;
+        }
+        if (m_ex_mode == "seq" || n_rows <= parallel_chunk_rows) {
+            for (std::size_t i = 0; i < n_rows; ++i) {
+                encode_row(m_buf, plan, i);
+                if (m_buf.size() >= m_buffer_size) {
+                    write_buf(m_buf);
+                    m_buf.clear();
+                }
+            }
+            return;
+        }
+        write_buf(m_buf);
+        m_buf.clear();
+        auto ex = grppi_utils::dyn_ex(m_ex_mode);
+        // the rows are formatted in rounds of n_chunks chunks, so the
+        // memory used is bounded by the size of the chunk buffers.
+        auto n_chunks =
+            std::max<std::size_t>(std::thread::hardware_concurrency(), 1) * 2;
+        m_chunk_bufs.resize(n_chunks);
+        std::vector<std::size_t> chunk_indices(n_chunks);
+        std::iota(chunk_indices.begin(), chunk_indices.end(), 0);
+        std::vector<std::size_t> chunk_sizes(n_chunks);
+        for (std::size_t begin = 0; begin < n_rows;
+             begin += n_chunks * parallel_chunk_rows) {
+            grppi::map(ex, chunk_indices.begin(), chunk_indices.end(),
+                       chunk_sizes.begin(), [&](auto c) {
+                           auto &buf = m_chunk_bufs[c];
+                           buf.clear();
+                           auto first = begin + c * parallel_chunk_rows;
+                           auto last =
+                               std::min(first + parallel_chunk_rows, n_rows);
+                           for (auto i = first; i < last; ++i) {
+                               encode_row(buf, plan, i);
+                           }
+                           return buf.size();
+                       });
+            for (const auto &buf : m_chunk_bufs) {
+                write_buf(buf);
+            }
+        }
+    }
+
+    /// @brief Write the buffered data to the stream.
+    void flush() {
+        write_buf(m_buf);
+        m_buf.clear();
+        m_os.flush();
+    }
+
+    /// @brief Return the encode plan for the loaded columns of \p tbl.
+    template <TableLayout layout, StringStorage string_storage>
+    static auto make_plan(const BasicECSVTable<layout, string_storage> &tbl)
+        -> plan_t {
+        plan_t plan;
+        for (auto idx : tbl.header_view().indices()) {
+            tbl.visit_array_data(idx, [&](const auto &array_data, auto j) {
+                using array_data_t = std::decay_t<decltype(array_data)>;
+                using value_t = typename array_data_t::value_t;
+                if constexpr (array_data_t::is_arena_data) {
+                    plan.push_back({field_encoder<value_t>(), nullptr, 0,
+                                    &array_data.array()[j]});
+                } else {
+                    auto [ptr, stride] = array_data.col_data(j);
+                    plan.push_back(
+                        {field_encoder<value_t>(),
+                         reinterpret_cast<const std::byte *>(ptr), // NOLINT
+                         stride * static_cast<std::ptrdiff_t>(sizeof(value_t)),
+                         nullptr});
+                }
+            });
+        }
+        return plan;
+    }
+
+private:
+    std::ostream &m_os;
+    std::string m_ex_mode;
+    std::size_t m_buffer_size;
+    char m_delimiter{spec::ECSV_DELIM_CHAR};
+    std::string m_buf;
+    std::vector<std::string> m_chunk_bufs;
+
+    void write_buf(const std::string &buf) {
+        m_os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+
+    void encode_row(std::string &out, const plan_t &plan,
+                    std::size_t row_idx) const {
+        for (std::size_t j = 0; j < plan.size(); ++j) {
+            if (j > 0) {
+                out.push_back(m_delimiter);
+            }
+            const auto &p = plan[j];
+            if (p.arena != nullptr) {
+                encode_field(out, (*p.arena)[row_idx]);
+                continue;
+            }
+            p.encode(out,
+                     p.data + static_cast<std::ptrdiff_t>(row_idx) * p.stride);
+        }
+        out.push_back('\n');
+    }
+};
+
+} // namespace tula::ecsv
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tula::mmap_utils {
+
+/// @brief Hint of the expected access pattern of mapped memory.
+enum class Advice { normal, sequential, random, willneed, dontneed };
+
+/// @brief The access of mapped memory.
+enum class MapMode {
+    read_only,     ///< The mapped memory is read-only.
+    copy_on_write, ///< The mapped memory is writable, and the changes are
+                   ///< private to the mapping and not written to the file.
+};
+
+namespace internal {
+
+/// @brief Throw the error \p err, which is saved before the cleanup calls
+/// that may change errno.
+inline auto throw_errno(std::string_view what, const std::string &path,
+                        int err = errno) {
+    throw std::runtime_error(
+        fmt::format("{} {}: {}", what, path, std::strerror(err)));
+}
+
+constexpr auto to_madvise(Advice advice) noexcept -> int {
+    switch (advice) {
+    case Advice::sequential:
+        return MADV_SEQUENTIAL;
+    case Advice::random:
+        return MADV_RANDOM;
+    case Advice::willneed:
+        return MADV_WILLNEED;
+    case Advice::dontneed:
+        return MADV_DONTNEED;
+    default:
+        return MADV_NORMAL;
+    }
+}
+
+} // namespace internal
+
+/**
+ * @brief RAII wrapper of a memory-mapped file.
+ *
+ * The file is mapped entirely on construction and unmapped on
+ * destruction. Empty files are valid and have no mapping.
+ */
+struct MappedFile {
+    MappedFile(std::string path, MapMode mode = MapMode::read_only)
+        : m_path(std::move(path)), m_mode{mode} {
+        auto fd = ::open(m_path.c_str(), O_RDONLY); // NOLINT
+        if (fd < 0) {
+            internal::throw_errno("unable to open", m_path);
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            auto err = errno;
+            ::close(fd);
+            internal::throw_errno("unable to stat", m_path, err);
+        }
+        m_size = static_cast<std::size_t>(st.st_size);
+        if (m_size > 0) {
+            auto prot = mode == MapMode::read_only ? PROT_READ
+                                                   : PROT_READ | PROT_WRITE;
+            m_data = ::mmap(nullptr, m_size, prot, MAP_PRIVATE, fd, 0);
+        }
+        auto err = errno;
+        // the mapping is kept alive after the fd is closed
+        ::close(fd);
+        if (m_data == MAP_FAILED) { // NOLINT
+            m_data = nullptr;
+            internal::throw_errno("unable to mmap", m_path, err);
+        }
+    }
+    ~MappedFile() {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+        }
+    }
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+    MappedFile(MappedFile &&other) noexcept
+        : m_path{std::move(other.m_path)}, m_mode{other.m_mode},
+          m_data{other.m_data}, m_size{other.m_size} {
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    auto operator=(MappedFile &&) -> MappedFile & = delete;
+
+    auto path() const noexcept -> const std::string & { return m_path; }
+    auto mode() const noexcept -> MapMode { return m_mode; }
+    auto data() const noexcept -> const char * {
+        return static_cast<const char *>(m_data);
+    }
+    /// @brief Return the writable mapped memory of copy-on-write mapping.
+    auto mutable_data() const -> char * {
+        if (m_mode == MapMode::read_only) {
+            throw std::runtime_error(
+                fmt::format("mapping of {} is read-only", m_path));
+        }
+        return static_cast<char *>(m_data);
+    }
+    auto size() const noexcept -> std::size_t { return m_size; }
+    auto empty() const noexcept -> bool { return m_size == 0; }
+    auto view() const noexcept -> std::string_view { return {data(), m_size}; }
+
+    /// @brief Advise the kernel on the access pattern of the mapping.
+    void advise(Advice advice) const noexcept {
+        if (m_data != nullptr) {
+            ::madvise(m_data, m_size, internal::to_madvise(advice));
+        }
+    }
+    /// @brief Advise the kernel on the access pattern of \p size bytes
+    /// from \p offset. The range is extended to the page boundaries.
+    void advise(Advice advice, std::size_t offset,
+                std::size_t size) const noexcept {
+        if (m_data == nullptr || offset >= m_size) {
+            return;
+        }
+        static const auto page_size =
+            static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto begin = offset / page_size * page_size;
+        auto end = std::min(offset + size, m_size);
+        ::madvise(static_cast<char *>(m_data) + begin, end - begin,
+                  internal::to_madvise(advice));
+    }
+
+private:
+    std::string m_path;
+    MapMode m_mode{MapMode::read_only};
+    void *m_data{nullptr};
+    std::size_t m_size{0};
+};
+
+} // namespace tula::mmap_utils
@@ -1,51 +1,235 @@
 #pragma once
 #include "../meta.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
 #include <mutex>
+#include <thread>
+#include <utility>
 
 namespace tula::nddata {
 
 /// @brief Data object that evaluate only on first call.
-template <typename DataType, auto evaluate>
+/// The evaluation is guarded by a mutex, and the reads after it are
+/// acquire loads of the initialized flag and the dependency generations,
+/// so concurrent readers do not serialize. \ref invalidate is safe with
+/// concurrent evaluation, but the references returned before it are not to
+/// be used after the next evaluation.
+///
+/// The data may depend on \p n_deps other cached data, which are passed
+/// on each call. The generation of each of them, which increments on each
+/// evaluation, is recorded when evaluating, and the data are evaluated
+/// again when any of them differs. So invalidating an upstream data only
+/// re-evaluates the downstream data that are read afterwards.
+///
+/// The evaluation can be started on a worker thread with \ref prefetch,
+/// and the calls after it block until it is done. The error of it is
+/// raised by the next call. The parent has to stay alive until the
+/// evaluation is done.
+template <typename DataType, auto evaluate, std::size_t n_deps = 0>
 struct CachedData {
+    using generation_t = std::uint64_t;
 
     CachedData() = default;
     CachedData(const CachedData &other) noexcept
-        : data(other.data), initialized(other.initialized) {}
+        : data((other.wait_prefetch(), other.data)),
+          initialized(other.is_initialized()),
+          m_generation(other.generation()) {
+        copy_dep_generations(other);
+    }
     CachedData(CachedData &&other) noexcept
-        : data(std::move(other.data)), initialized(other.initialized) {}
-    ~CachedData() = default;
+        : data((other.wait_prefetch(), std::move(other.data))),
+          initialized(other.is_initialized()),
+          m_generation(other.generation()) {
+        copy_dep_generations(other);
+    }
+    ~CachedData() { wait_prefetch(); }
     auto operator=(const CachedData &other) noexcept -> CachedData & {
+        wait_prefetch();
+        other.wait_prefetch();
         data = other.data;
-        initialized = other.initialized;
+        copy_state(other);
         return *this;
     }
     auto operator=(CachedData &&other) noexcept -> CachedData & {
+        wait_prefetch();
+        other.wait_prefetch();
         data = std::move(other.data);
-        initialized = other.initialized;
+        copy_state(other);
         return *this;
     }
 
     /// @brief Return the cached data
-    template <typename T>
-    auto operator()(T &parent) const -> const auto & {
+    /// @param deps The cached data this depends on, which are up to date.
+    template <typename T, typename... Deps>
+    requires(sizeof...(Deps) == n_deps)
+    auto operator()(T &parent, const Deps &...deps) const -> const auto & {
+        if (initialized.load(std::memory_order_acquire) &&
+            deps_unchanged(deps...)) {
+            return data;
+        }
+        wait();
+        rethrow_prefetch_error();
         std::scoped_lock lock(m_mutex);
-        if (!initialized) {
+        if (!initialized.load(std::memory_order_relaxed) ||
+            !deps_unchanged(deps...)) {
+            // the generations are taken before the evaluation, so the
+            // changes during it are detected on the next call
+            std::array<generation_t, n_deps> dep_generations{
+                deps.generation()...};
             data = evaluate(parent);
-            initialized = true;
+            // the generations are published with release, so the readers
+            // that see them in the fast path also see the data
+            for (std::size_t i = 0; i < n_deps; ++i) {
+                m_dep_generations[i].store(dep_generations[i],
+                                           std::memory_order_release);
+            }
+            m_generation.fetch_add(1, std::memory_order_release);
+            initialized.store(true, std::memory_order_release);
         }
         return data;
     }
 
+    /// @brief Start evaluating the data on a worker thread, and return
+    /// immediately. Nothing is done if the data are evaluated or being
+    /// evaluated.
+    template <typename T>
+    requires(n_deps == 0)
+    void prefetch(T &parent) const {
+        if (is_initialized()) {
+            return;
+        }
+        prefetch_with([this, &parent] { (*this)(parent); });
+    }
+
+    /// @brief Start calling \p getter on a worker thread, and return
+    /// immediately. The getter is to read this cached data, e.g., with the
+    /// dependencies refreshed. Nothing is done if a prefetch is pending.
+    template <typename F>
+    void prefetch_with(F &&getter) const {
+        std::scoped_lock lock(m_prefetch_mutex);
+        if (m_prefetching.load(std::memory_order_acquire)) {
+            return;
+        }
+        m_prefetching.store(true, std::memory_order_release);
+        m_prefetch =
+            std::async(std::launch::async,
+                       [this, getter = std::forward<F>(getter)] {
+                           m_worker_id.store(std::this_thread::get_id(),
+                                             std::memory_order_release);
+                           std::exception_ptr error{};
+                           try {
+                               getter();
+                           } catch (...) {
+                               error = std::current_exception();
+                           }
+                           m_worker_id.store(std::thread::id{},
+                                             std::memory_order_release);
+                           std::scoped_lock lock(m_prefetch_mutex);
+                           m_prefetch_error = std::move(error);
+                           m_prefetching.store(false,
+                                               std::memory_order_release);
+                       })
+                .share();
+    }
+
+    /// @brief Block until the evaluation started by \ref prefetch is done.
+    void wait() const {
+        if (is_prefetch_worker() ||
+            !m_prefetching.load(std::memory_order_acquire)) {
+            return;
+        }
+        wait_prefetch();
+    }
+
     /// @brief Invalidate the cached data.
     void invalidate() const {
         std::scoped_lock lock(m_mutex);
-        initialized = false;
+        initialized.store(false, std::memory_order_release);
+    }
+
+    /// @brief Return true if the data are evaluated.
+    auto is_initialized() const noexcept -> bool {
+        return initialized.load(std::memory_order_acquire);
+    }
+
+    /// @brief Return the number of evaluations.
+    auto generation() const noexcept -> generation_t {
+        return m_generation.load(std::memory_order_acquire);
     }
 
 private:
     mutable DataType data;
-    mutable bool initialized{false};
+    mutable std::atomic<bool> initialized{false};
+    mutable std::atomic<generation_t> m_generation{0};
+    mutable std::array<std::atomic<generation_t>, n_deps> m_dep_generations{};
     mutable std::mutex m_mutex{};
+    mutable std::mutex m_prefetch_mutex{};
+    /// @brief The pending evaluation, which is waited for on destruction.
+    mutable std::shared_future<void> m_prefetch{};
+    mutable std::atomic<bool> m_prefetching{false};
+    /// @brief The error of the last prefetch, raised by the next call.
+    mutable std::exception_ptr m_prefetch_error{};
+
+    /// @brief The thread running the pending evaluation of this object.
+    mutable std::atomic<std::thread::id> m_worker_id{};
+
+    /// @brief True on the worker thread of this object, which does not wait
+    /// for the pending evaluation that it runs.
+    auto is_prefetch_worker() const noexcept -> bool {
+        return m_worker_id.load(std::memory_order_acquire) ==
+               std::this_thread::get_id();
+    }
+
+    // the lock is not held while waiting, as the worker takes it when done.
+    // This is noexcept so that the copy and move are, and a failed lock
+    // terminates.
+    void wait_prefetch() const noexcept {
+        std::shared_future<void> prefetch{};
+        {
+            std::scoped_lock lock(m_prefetch_mutex);
+            prefetch = m_prefetch;
+        }
+        if (prefetch.valid()) {
+            prefetch.wait();
+        }
+    }
+
+    void rethrow_prefetch_error() const {
+        if (is_prefetch_worker()) {
+            return;
+        }
+        std::exception_ptr error{};
+        {
+            std::scoped_lock lock(m_prefetch_mutex);
+            error = std::exchange(m_prefetch_error, nullptr);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    template <typename... Deps>
+    auto deps_unchanged(const Deps &...deps) const noexcept -> bool {
+        [[maybe_unused]] std::size_t i = 0;
+        return (... && (deps.generation() ==
+                        m_dep_generations[i++].load(
+                            std::memory_order_acquire)));
+    }
+    void copy_dep_generations(const CachedData &other) noexcept {
+        for (std::size_t i = 0; i < n_deps; ++i) {
+            m_dep_generations[i].store(
+                other.m_dep_generations[i].load(std::memory_order_acquire),
+                std::memory_order_release);
+        }
+    }
+    void copy_state(const CachedData &other) noexcept {
+        copy_dep_generations(other);
+        m_generation.store(other.generation(), std::memory_order_release);
+        initialized.store(other.is_initialized(), std::memory_order_release);
+    }
 };
 
 } // namespace tula::nddata
@@ -55,6 +239,8 @@ private:
 public:                                                                        \
     auto name() const->decltype(auto) { return m_##name(*this); }              \
     auto name()->decltype(auto) { return m_##name(*this); }                    \
+    void name##_prefetch() const { m_##name.prefetch(*this); }                 \
+    void name##_prefetch() { m_##name.prefetch(*this); }                       \
     auto name##_invalidate() noexcept->decltype(auto) {                        \
         m_##name.invalidate();                                                 \
         return *this;                                                          \
@@ -80,3 +266,51 @@ private:                                                                       \
                                                                                \
 private:                                                                       \
     tula::nddata::CachedData<return_type, evaluate> m_##name {}
+
+#define TULA_CACHED_DEPS(...)                                                  \
+    TULA_GET_MACRO_NARG_OVERLOAD(TULA_CACHED_DEPS, __VA_ARGS__)
+// each dependency is refreshed via its getter before its cache is passed
+#define TULA_CACHED_DEPS1(x1) (x1(), m_##x1)
+#define TULA_CACHED_DEPS2(x1, x2) TULA_CACHED_DEPS1(x1), TULA_CACHED_DEPS1(x2)
+#define TULA_CACHED_DEPS3(x1, x2, x3)                                          \
+    TULA_CACHED_DEPS2(x1, x2), TULA_CACHED_DEPS1(x3)
+#define TULA_CACHED_DEPS4(x1, x2, x3, x4)                                      \
+    TULA_CACHED_DEPS3(x1, x2, x3), TULA_CACHED_DEPS1(x4)
+#define TULA_CACHED_DEPS5(x1, x2, x3, x4, x5)                                  \
+    TULA_CACHED_DEPS4(x1, x2, x3, x4), TULA_CACHED_DEPS1(x5)
+
+/// @brief Cached getter \p name evaluated with name##_evaluator, which
+/// depends on the other cached getters listed after \p return_type.
+/// Invalidating any of them makes \p name evaluated again on the next
+/// call.
+#define TULA_CACHED_GETTER_DEPS(name, return_type, ...)                        \
+                                                                               \
+public:                                                                        \
+    auto name() const->decltype(auto) {                                        \
+        m_##name.wait();                                                       \
+        return m_##name(*this, TULA_CACHED_DEPS(__VA_ARGS__));                 \
+    }                                                                          \
+    auto name()->decltype(auto) {                                              \
+        m_##name.wait();                                                       \
+        return m_##name(*this, TULA_CACHED_DEPS(__VA_ARGS__));                 \
+    }                                                                          \
+    void name##_prefetch() const {                                             \
+        m_##name.prefetch_with([this] { name(); });                            \
+    }                                                                          \
+    void name##_prefetch() {                                                   \
+        m_##name.prefetch_with([this] { name(); });                            \
+    }                                                                          \
+    auto name##_invalidate() noexcept->decltype(auto) {                        \
+        m_##name.invalidate();                                                 \
+        return *this;                                                          \
+    }                                                                          \
+    auto name##_invalidate() const noexcept->decltype(auto) {                  \
+        m_##name.invalidate();                                                 \
+        return *this;                                                          \
+    }                                                                          \
+                                                                               \
+private:                                                                       \
+    tula::nddata::CachedData<return_type,                                      \
+                             TULA_LIFT1(name##_evaluator::evaluate),           \
+                             TULA_DETAILS_NARG2(__VA_ARGS__)>                  \
+        m_##name {}
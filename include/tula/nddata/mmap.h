@@ -0,0 +1,127 @@
+#pragma once
+
+#include "../mmap.h"
+#include "core.h"
+#include <Eigen/Core>
+#include <string>
+#include <type_traits>
+
+namespace tula::nddata {
+
+template <typename Scalar, int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic,
+          int Order = Eigen::ColMajor,
+          mmap_utils::MapMode mode = mmap_utils::MapMode::read_only>
+struct MmapEigenData;
+
+template <typename Scalar, int Rows, int Cols, int Order,
+          mmap_utils::MapMode mode>
+struct type_traits<MmapEigenData<Scalar, Rows, Cols, Order, mode>>
+    : type_traits<void> {
+    using Base = type_traits<void>;
+    using index_t = Eigen::Index;
+    using physical_type_t = Base::physical_type_t;
+    using unit_t = Base::unit_t;
+    using label_t = Base::label_t;
+};
+
+/**
+ * @brief A NDData class that maps raw binary file as Eigen matrix.
+ *
+ * The file holds the \p Scalar values in \p Order, from a byte offset to
+ * the end, and its size has to match the shape exactly. The data are paged
+ * in from the file on access, so the matrix can be larger than the memory.
+ * The file stays mapped for the lifetime of the object, which is move-only.
+ *
+ * With \p mode of tula::mmap_utils::MapMode::copy_on_write, the data are
+ * writable, and the changes are not written to the file.
+ */
+template <typename Scalar, int Rows, int Cols, int Order,
+          mmap_utils::MapMode mode>
+struct MmapEigenData
+    : NDData<MmapEigenData<Scalar, Rows, Cols, Order, mode>> {
+    using Base = NDData<MmapEigenData<Scalar, Rows, Cols, Order, mode>>;
+    using index_t = typename Base::index_t;
+    using plain_t = Eigen::Matrix<Scalar, Rows, Cols, Order>;
+    constexpr static bool is_writable =
+        mode != mmap_utils::MapMode::read_only;
+    using map_t =
+        Eigen::Map<std::conditional_t<is_writable, plain_t, const plain_t>>;
+
+    /// @brief Map file \p path as matrix of \p rows x \p cols.
+    /// One of the dimensions can be Eigen::Dynamic, in which case it is
+    /// inferred from the file size.
+    /// @param offset The byte offset of the data in the file.
+    MmapEigenData(std::string path, index_t rows = Rows, index_t cols = Cols,
+                  std::size_t offset = 0)
+        : m_file{std::move(path), mode}, m_offset{check_offset(m_file, offset)},
+          data{make_map(m_file, rows, cols, m_offset)} {}
+
+    /// @brief Advise the kernel on the access pattern of the data.
+    void advise(mmap_utils::Advice advice) const noexcept {
+        m_file.advise(advice, m_offset, size_bytes());
+    }
+    /// @brief Advise the kernel on the access pattern of the contiguous
+    /// \p n outer vectors from \p i, which are the columns for column-major
+    /// order and the rows otherwise.
+    void advise(mmap_utils::Advice advice, index_t i,
+                index_t n) const noexcept {
+        auto inner_size = static_cast<std::size_t>(data.innerSize());
+        m_file.advise(advice,
+                      m_offset + static_cast<std::size_t>(i) * inner_size *
+                                     sizeof(Scalar),
+                      static_cast<std::size_t>(n) * inner_size *
+                          sizeof(Scalar));
+    }
+
+    auto file() const noexcept -> const mmap_utils::MappedFile & {
+        return m_file;
+    }
+    auto size_bytes() const noexcept -> std::size_t {
+        return static_cast<std::size_t>(data.size()) * sizeof(Scalar);
+    }
+
+private:
+    mmap_utils::MappedFile m_file;
+    std::size_t m_offset{0};
+
+    static auto check_offset(const mmap_utils::MappedFile &file,
+                             std::size_t offset) -> std::size_t {
+        if (offset > file.size() || offset % alignof(Scalar) != 0) {
+            throw std::runtime_error(fmt::format(
+                "invalid offset {} of data in {}", offset, file.path()));
+        }
+        return offset;
+    }
+
+    static auto make_map(const mmap_utils::MappedFile &file, index_t rows,
+                         index_t cols, std::size_t offset) -> map_t {
+        auto size = file.size() - offset;
+        auto n = static_cast<index_t>(size / sizeof(Scalar));
+        if (rows == Eigen::Dynamic && cols > 0) {
+            rows = n / cols;
+        } else if (cols == Eigen::Dynamic && rows > 0) {
+            cols = n / rows;
+        }
+        if (rows < 0 || cols < 0 || (Rows != Eigen::Dynamic && rows != Rows) ||
+            (Cols != Eigen::Dynamic && cols != Cols) ||
+            static_cast<std::size_t>(rows * cols) * sizeof(Scalar) != size) {
+            throw std::runtime_error(fmt::format(
+                "unable to map {} bytes of {} as {}x{} matrix", size,
+                file.path(), rows, cols));
+        }
+        if constexpr (is_writable) {
+            return {reinterpret_cast<Scalar *>( // NOLINT
+                        file.mutable_data() + offset),
+                    rows, cols};
+        } else {
+            return {reinterpret_cast<const Scalar *>( // NOLINT
+                        file.data() + offset),
+                    rows, cols};
+        }
+    }
+
+public:
+    map_t data;
+};
+
+} // namespace tula::nddata
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "../grppi.h"
+#include "core.h"
+#include "eigen.h"
+#include <Eigen/Core>
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tula::nddata {
+
+template <typename Scalar, Eigen::Index TileRows = 64,
+          Eigen::Index TileCols = 64>
+struct TiledEigenData;
+
+template <typename Scalar, Eigen::Index TileRows, Eigen::Index TileCols>
+struct type_traits<TiledEigenData<Scalar, TileRows, TileCols>>
+    : type_traits<void> {
+    using Base = type_traits<void>;
+    using index_t = Eigen::Index;
+    using physical_type_t = Base::physical_type_t;
+    using unit_t = Base::unit_t;
+    using label_t = Base::label_t;
+};
+
+/**
+ * @brief A NDData class that holds 2-D data as fixed-size tiles.
+ *
+ * The matrix is split to tiles of \p TileRows x \p TileCols, and each tile
+ * is stored contiguously in column-major order, so a kernel that works on
+ * one tile at a time touches a block that fits in the cache, regardless of
+ * the order it walks the tile in. The tiles are stored in column-major
+ * order of the tile grid. The tiles at the bottom and right edges are
+ * padded to the full size, and the padding is not visible in the tile
+ * views.
+ *
+ * The default 64 x 64 tile of double is 32 KiB.
+ */
+template <typename Scalar, Eigen::Index TileRows, Eigen::Index TileCols>
+struct TiledEigenData : NDData<TiledEigenData<Scalar, TileRows, TileCols>> {
+    static_assert(TileRows > 0 && TileCols > 0, "invalid tile size");
+    using Base = NDData<TiledEigenData<Scalar, TileRows, TileCols>>;
+    using index_t = typename Base::index_t;
+    using plain_t = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    constexpr static index_t tile_rows = TileRows;
+    constexpr static index_t tile_cols = TileCols;
+    constexpr static index_t tile_size = TileRows * TileCols;
+    using stride_t = Eigen::OuterStride<TileRows>;
+    /// @brief The tile views, which map the valid region of the tiles.
+    using tile_t = Eigen::Map<plain_t, Eigen::Unaligned, stride_t>;
+    using const_tile_t = Eigen::Map<const plain_t, Eigen::Unaligned, stride_t>;
+
+    TiledEigenData() = default;
+    /// @brief Create zero-initialized data of \p rows x \p cols.
+    TiledEigenData(index_t rows, index_t cols)
+        : m_rows{rows}, m_cols{cols},
+          m_n_tile_rows{n_tiles_of(rows, TileRows)},
+          m_n_tile_cols{n_tiles_of(cols, TileCols)} {
+        if (rows < 0 || cols < 0) {
+            throw std::runtime_error(
+                fmt::format("invalid shape {}x{} of tiled data", rows, cols));
+        }
+        data.resize(static_cast<std::size_t>(n_tiles() * tile_size),
+                    Scalar{0});
+    }
+    /// @brief Create data from the Eigen matrix \p m.
+    template <typename Derived>
+    explicit TiledEigenData(const Eigen::DenseBase<Derived> &m)
+        : TiledEigenData(m.rows(), m.cols()) {
+        for (index_t k = 0; k < n_tiles(); ++k) {
+            auto [i, j] = tile_origin(k);
+            auto t = tile(k);
+            t = m.block(i, j, t.rows(), t.cols());
+        }
+    }
+
+    auto rows() const noexcept -> index_t { return m_rows; }
+    auto cols() const noexcept -> index_t { return m_cols; }
+    auto n_tile_rows() const noexcept -> index_t { return m_n_tile_rows; }
+    auto n_tile_cols() const noexcept -> index_t { return m_n_tile_cols; }
+    auto n_tiles() const noexcept -> index_t {
+        return m_n_tile_rows * m_n_tile_cols;
+    }
+
+    /// @brief Return the tile grid position of tile \p k.
+    auto tile_index(index_t k) const noexcept
+        -> std::pair<index_t, index_t> {
+        return {k % m_n_tile_rows, k / m_n_tile_rows};
+    }
+    /// @brief Return the matrix position of the first element of tile \p k.
+    auto tile_origin(index_t k) const noexcept
+        -> std::pair<index_t, index_t> {
+        auto [ti, tj] = tile_index(k);
+        return {ti * TileRows, tj * TileCols};
+    }
+
+    /// @brief Return the view of tile \p k.
+    auto tile(index_t k) -> tile_t {
+        auto [i, j] = tile_origin(k);
+        return {tile_ptr(k), std::min(TileRows, m_rows - i),
+                std::min(TileCols, m_cols - j)};
+    }
+    auto tile(index_t k) const -> const_tile_t {
+        auto [i, j] = tile_origin(k);
+        return {tile_ptr(k), std::min(TileRows, m_rows - i),
+                std::min(TileCols, m_cols - j)};
+    }
+    /// @brief Return the view of tile at \p ti, \p tj of the tile grid.
+    auto tile(index_t ti, index_t tj) -> tile_t {
+        return tile(tj * m_n_tile_rows + ti);
+    }
+    auto tile(index_t ti, index_t tj) const -> const_tile_t {
+        return tile(tj * m_n_tile_rows + ti);
+    }
+
+    /// @brief Return the NDData view of tile \p k.
+    /// The view holds a \ref tile_t map, and a copy of the map writes to
+    /// the tile.
+    auto tile_ref(index_t k) -> EigenDataRef<tile_t> { return tile(k); }
+    auto tile_ref(index_t ti, index_t tj) -> EigenDataRef<tile_t> {
+        return tile(ti, tj);
+    }
+    /// @brief Return the read-only NDData view of tile \p k.
+    auto tile_ref(index_t k) const -> EigenDataRef<const_tile_t> {
+        return tile(k);
+    }
+    auto tile_ref(index_t ti, index_t tj) const
+        -> EigenDataRef<const_tile_t> {
+        return tile(ti, tj);
+    }
+
+    /// @brief Return the range of the tile views, in the storage order.
+    auto tiles() {
+        return std::views::iota(index_t{0}, n_tiles()) |
+               std::views::transform([this](auto k) { return tile(k); });
+    }
+    auto tiles() const {
+        return std::views::iota(index_t{0}, n_tiles()) |
+               std::views::transform([this](auto k) { return tile(k); });
+    }
+
+    auto coeff(index_t i, index_t j) const -> const Scalar & {
+        return data[offset_of(i, j)];
+    }
+    auto coeffRef(index_t i, index_t j) -> Scalar & {
+        return data[offset_of(i, j)];
+    }
+
+    /// @brief Return the data as Eigen matrix.
+    auto to_eigen() const -> plain_t {
+        plain_t m(m_rows, m_cols);
+        for (index_t k = 0; k < n_tiles(); ++k) {
+            auto [i, j] = tile_origin(k);
+            auto t = tile(k);
+            m.block(i, j, t.rows(), t.cols()) = t;
+        }
+        return m;
+    }
+
+    /**
+     * @brief Call \p f on each tile with GRPPI execution mode \p ex_mode.
+     *
+     * \p f is called as `f(tile, ti, tj)` with the \ref tile_t view, or
+     * \ref const_tile_t if const, and the tile grid position. The tiles
+     * are split to contiguous runs, one per task, and \p f has to be safe
+     * to call on different tiles concurrently. If \p f throws, the rest of
+     * the run is skipped, and the first error in the tile order is
+     * rethrown after all runs are done.
+     */
+    template <typename F>
+    void parallel_for_tiles(std::string_view ex_mode, F &&f) {
+        for_tiles_impl(*this, ex_mode, f);
+    }
+    template <typename F>
+    void parallel_for_tiles(std::string_view ex_mode, F &&f) const {
+        for_tiles_impl(*this, ex_mode, f);
+    }
+    /// @brief Call \p f on each tile with the default GRPPI execution mode.
+    template <typename F>
+    void parallel_for_tiles(F &&f) {
+        parallel_for_tiles(grppi_utils::default_mode_name(), f);
+    }
+    template <typename F>
+    void parallel_for_tiles(F &&f) const {
+        parallel_for_tiles(grppi_utils::default_mode_name(), f);
+    }
+
+    /// @brief The tile storage.
+    std::vector<Scalar> data{};
+
+private:
+    index_t m_rows{0};
+    index_t m_cols{0};
+    index_t m_n_tile_rows{0};
+    index_t m_n_tile_cols{0};
+
+    constexpr static auto n_tiles_of(index_t n, index_t tile_n) noexcept
+        -> index_t {
+        return n <= 0 ? 0 : (n + tile_n - 1) / tile_n;
+    }
+    auto tile_ptr(index_t k) noexcept -> Scalar * {
+        return data.data() + k * tile_size;
+    }
+    auto tile_ptr(index_t k) const noexcept -> const Scalar * {
+        return data.data() + k * tile_size;
+    }
+    auto offset_of(index_t i, index_t j) const noexcept -> std::size_t {
+        auto k = (j / TileCols) * m_n_tile_rows + i / TileRows;
+        return static_cast<std::size_t>(k * tile_size +
+                                        (j % TileCols) * TileRows +
+                                        i % TileRows);
+    }
+
+    template <typename Self, typename F>
+    static void for_tiles_impl(Self &self, std::string_view ex_mode, F &f) {
+        constexpr index_t runs_per_thread = 4;
+        auto n = self.n_tiles();
+        auto n_runs = std::clamp<index_t>(
+            runs_per_thread *
+                std::max<index_t>(std::thread::hardware_concurrency(), 1),
+            1, std::max<index_t>(n, 1));
+        std::vector<index_t> run_indices(static_cast<std::size_t>(n_runs));
+        std::iota(run_indices.begin(), run_indices.end(), 0);
+        std::vector<index_t> run_sizes(run_indices.size());
+        // the errors are rethrown after all runs are done, because throwing
+        // from the worker threads terminates the process.
+        std::vector<std::exception_ptr> run_errors(run_indices.size());
+        auto ex = grppi_utils::dyn_ex(ex_mode);
+        grppi::map(ex, run_indices.begin(), run_indices.end(),
+                   run_sizes.begin(), [&](auto r) {
+                       auto begin = n * r / n_runs;
+                       auto end = n * (r + 1) / n_runs;
+                       try {
+                           for (auto k = begin; k < end; ++k) {
+                               auto [ti, tj] = self.tile_index(k);
+                               f(self.tile(k), ti, tj);
+                           }
+                       } catch (...) {
+                           run_errors[static_cast<std::size_t>(r)] =
+                               std::current_exception();
+                       }
+                       return end - begin;
+                   });
+        for (const auto &error : run_errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+};
+
+} // namespace tula::nddata
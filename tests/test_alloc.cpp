@@ -0,0 +1,150 @@
+#include "test_common.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <new>
+#include <sstream>
+#include <tula/ecsv/table.h>
+#include <vector>
+
+// The global allocation functions are replaced in this test executable
+// only, so that the other tests run with the default allocator.
+
+namespace {
+/// @brief The number of heap allocations on the current thread.
+thread_local std::size_t n_allocations = 0;
+/// @brief The number of malloc calls of at least
+/// \ref large_allocation_size on the current thread.
+thread_local std::size_t n_large_allocations = 0;
+constexpr std::size_t large_allocation_size = 1 << 20;
+} // namespace
+
+// NOLINTBEGIN
+[[gnu::noinline]] void *operator new(std::size_t size) {
+    ++n_allocations;
+    if (auto *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+[[gnu::noinline]] void *operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+[[gnu::noinline]] void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+#if defined(__GLIBC__)
+// Eigen allocates with malloc, so the large allocations are counted there.
+// glibc's own malloc stays in use, so free and realloc are not replaced.
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *malloc(std::size_t size) noexcept {
+    if (size >= large_allocation_size) {
+        ++n_large_allocations;
+    }
+    return __libc_malloc(size);
+}
+}
+#define TULA_TEST_COUNT_MALLOC
+#endif
+// NOLINTEND
+
+namespace {
+
+/// @brief Write a table of \p n_rows to file in the temp dir and return
+/// the path.
+auto write_temp_table(const std::string &name, std::size_t n_rows) {
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: x, datatype: float64}\n"
+          "# - {name: y, datatype: float64}\n"
+          "id x y\n";
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        ss << fmt::format("{} {} {}\n", i, 0.5 * double(i), -double(i));
+    }
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream(path) << ss.str();
+    return path;
+}
+
+TEST(alloc, ecsv_col_access) {
+    using namespace tula::ecsv;
+    constexpr std::size_t n_rows = 100;
+    auto path = write_temp_table("tula_test_alloc_col_access.ecsv", n_rows);
+    auto tbl = ECSVTable::from_mmap(path, ColumnStatsPolicy::collect);
+    // no allocation in repeated access
+    double sum{0};
+    auto n0 = n_allocations;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        auto r = Eigen::Index(i % n_rows);
+        sum += tbl.col<double>("x")(r);
+        sum += tbl.col_map<double>("x")(r);
+        sum += double(tbl.col_span<int64_t>("id")[i % n_rows]);
+        sum += tbl.stats("x").sum;
+    }
+    EXPECT_EQ(n_allocations, n0);
+    EXPECT_GT(sum, 0);
+    std::filesystem::remove(path);
+}
+
+TEST(alloc, ecsv_load_tables) {
+#ifndef TULA_TEST_COUNT_MALLOC
+    GTEST_SKIP() << "malloc calls are counted with glibc only";
+#endif
+    using namespace tula::ecsv;
+    constexpr std::size_t n_rows = 45000;
+    auto path = write_temp_table("tula_test_alloc_load_tables.ecsv", n_rows);
+    std::vector<ECSVTable> tables;
+    tables.push_back(ECSVTable::from_mmap(path));
+    tables.push_back(ECSVTable::from_mmap(path));
+    auto tbl = ECSVTable(tables.front().header());
+    // the float64 data of the merged table are the only large array, and
+    // are allocated once
+    static_assert(2 * n_rows * 2 * sizeof(double) >= large_allocation_size);
+    static_assert(2 * n_rows * sizeof(int64_t) < large_allocation_size);
+    auto n0 = n_large_allocations;
+    tbl.load_tables(tables);
+    EXPECT_EQ(n_large_allocations, n0 + 1);
+    ASSERT_EQ(tbl.rows(), 2 * n_rows);
+    EXPECT_EQ(tbl.col<double>("y")(n_rows + 1), -1.0);
+    EXPECT_EQ(tbl.col<int64_t>("id")(2 * n_rows - 1), int64_t(n_rows - 1));
+    std::filesystem::remove(path);
+}
+
+/// @brief Access column by name in a hot loop, via the column reference or
+/// the column map. The allocations per iteration are reported.
+// NOLINTNEXTLINE
+void BM_ecsv_col_access(benchmark::State &state, bool use_map) {
+    using namespace tula::ecsv;
+    auto n_rows = state.range(0);
+    auto path = write_temp_table("tula_bench_alloc_col_access.ecsv",
+                                 std::size_t(n_rows));
+    auto tbl = ECSVTable::from_mmap(path);
+    std::filesystem::remove(path);
+    auto n0 = n_allocations;
+    double sum{0};
+    Eigen::Index i = 0;
+    for (auto _ : state) {
+        auto r = i++ % n_rows;
+        if (use_map) {
+            sum += tbl.col_map<double>("x")(r);
+        } else {
+            sum += tbl.col<double>("x")(r);
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.counters["allocs"] = benchmark::Counter(
+        double(n_allocations - n0), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_CAPTURE(BM_ecsv_col_access, col, false)->Arg(1 << 10);
+BENCHMARK_CAPTURE(BM_ecsv_col_access, col_map, true)->Arg(1 << 10);
+
+} // namespace
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdlib>
 #include <tula/logging.h>
 
 namespace tula::testing {
@@ -20,4 +21,10 @@ std::string fmtlog(FmtStr &&fmt_str, Args &&...args) {
     return result;
 };
 
+/// @brief Return true if the slow benchmarks are to be registered, which
+/// is the case with TULA_BENCH set.
+inline auto bench_enabled() -> bool {
+    return std::getenv("TULA_BENCH") != nullptr;
+}
+
 } // namespace tula::testing
@@ -44,6 +44,14 @@ TEST(container, slice) {
     auto s = parse_slice(":");
     fmtlog("s={}", s);
     fmtlog("r={}", to_indices(s, 10));
+    using bs_t = BoundedIndexSlice;
+    EXPECT_EQ(to_indices(s, 10), bs_t(0, 10, 1, 10));
+    EXPECT_EQ(to_indices(parse_slice("2:9:3"), 10), bs_t(2, 9, 3, 3));
+    EXPECT_EQ(to_indices(parse_slice("-3:"), 10), bs_t(7, 10, 1, 3));
+    EXPECT_EQ(to_indices(parse_slice(":-8"), 10), bs_t(0, 2, 1, 2));
+    EXPECT_EQ(to_indices(parse_slice("5:100"), 10), bs_t(5, 10, 1, 5));
+    EXPECT_EQ(to_indices(parse_slice("8:2"), 10), bs_t(8, 2, 1, 0));
+    EXPECT_EQ(to_indices(parse_slice("::-4"), 10), bs_t(9, -1, -4, 3));
 
     auto s1 = parse_slice<double>("0.1::0.01");
     fmtlog("s1={}", s1);
@@ -1,9 +1,20 @@
 #include "test_common.h"
 #include "tula/ecsv/core.h"
+#include <benchmark/benchmark.h>
 #include <csv_parser/parser.hpp>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <sstream>
+#include <tula/ecsv/cache.h>
+#include <tula/ecsv/decoder.h>
+#include <tula/ecsv/parallel.h>
+#include <tula/ecsv/rowindex.h>
+#include <tula/ecsv/stream.h>
 #include <tula/ecsv/table.h>
+#include <tula/ecsv/tokenizer.h>
+#include <tula/ecsv/writer.h>
+#include <tula/filename.h>
+#include <tula/filesystem.h>
 #include <tula/formatter/container.h>
 #include <tula/formatter/matrix.h>
 #include <yaml-cpp/node/emit.h>
@@ -100,6 +111,33 @@ uid nw pg loc ori fg design_group i j k x y f flag flag_summary
 )apt_header";
 // clang-format on
 
+/// @brief Create synthetic ECSV header and data rows for tests and benchmarks.
+/// The columns cycle through int64, float64 and float64.
+auto make_synthetic_table(std::size_t n_rows, std::size_t n_cols) {
+    using namespace tula::ecsv;
+    std::vector<ECSVColumn> cols;
+    for (std::size_t j = 0; j < n_cols; ++j) {
+        cols.push_back({fmt::format("c{}", j),
+                        (j % 3 == 0) ? dtype_str<int64_t>()
+                                     : dtype_str<double>()});
+    }
+    auto hdr = ECSVHeader(std::move(cols), YAML::Node{},
+                          spec::ECSV_DELIM_CHAR, std::nullopt, std::nullopt);
+    std::vector<std::vector<std::string>> rows(n_rows);
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        auto &row = rows[i];
+        row.reserve(n_cols);
+        for (std::size_t j = 0; j < n_cols; ++j) {
+            if (j % 3 == 0) {
+                row.push_back(fmt::format("{}", i * n_cols + j));
+            } else {
+                row.push_back(fmt::format("{:.6e}", 1e-3 * double(i + j)));
+            }
+        }
+    }
+    return std::tuple{std::move(hdr), std::move(rows)};
+}
+
 TEST(ecsv, parse_header) {
 
     using namespace tula::ecsv;
@@ -112,6 +150,53 @@ TEST(ecsv, parse_header) {
 
     EXPECT_EQ(processed[0], "# %ECSV 0.9");
     EXPECT_EQ(ecsv_hdr["schema"].as<std::string>(), "astropy-2.0");
+
+    std::size_t size{0};
+    auto [ecsv_hdr1, csv_hdr1] = parse_header_view(apt_header, &size);
+    EXPECT_EQ(size, header_size(apt_header));
+    EXPECT_EQ(YAML::Dump(ecsv_hdr1), YAML::Dump(ecsv_hdr));
+    EXPECT_EQ(csv_hdr1, csv_hdr);
+    EXPECT_EQ(ecsv_hdr1["_ecsv_spec_version"].as<std::string>(), "0.9");
+    EXPECT_THROW(parse_header_view("# %ECSV\n# ---\n"), ParseError);
+    EXPECT_THROW(parse_header_view("#  %ECSV 0.9\n"), ParseError);
+    EXPECT_THROW(parse_header_view("# %ECSV  \n# ---\n"), ParseError);
+    // any version text is accepted, without the trailing spaces
+    for (auto [line, version] : {std::pair{"# %ECSV 1.0 ", "1.0"},
+                                 std::pair{"# %ECSV 1.0rc1", "1.0rc1"},
+                                 std::pair{"# %ECSV 1.0\t\r", "1.0"}}) {
+        auto [ecsv_hdr_v, csv_hdr_v] =
+            parse_header_view(fmt::format("{}\n# ---\na\n", line));
+        EXPECT_EQ(ecsv_hdr_v["_ecsv_spec_version"].as<std::string>(), version)
+            << line;
+    }
+    auto [ecsv_hdr2, csv_hdr2] =
+        parse_header_view("# %ECSV 1.0\r\n# ---\n# datatype: []\na\n");
+    EXPECT_EQ(ecsv_hdr2["_ecsv_spec_version"].as<std::string>(), "1.0");
+    // the blank comment lines of CRLF files are part of the header
+    std::string crlf_header = "# %ECSV 1.0\r\n# ---\r\n#\r\n"
+                              "# datatype:\r\n"
+                              "# - {name: a, datatype: int64}\r\n"
+                              "a\r\n";
+    std::size_t size2{0};
+    auto [ecsv_hdr3, csv_hdr3] =
+        parse_header_view(crlf_header + "1\r\n2\r\n", &size2);
+    EXPECT_EQ(size2, crlf_header.size());
+    EXPECT_EQ(header_size(crlf_header + "1\r\n"), crlf_header.size());
+    EXPECT_EQ(csv_hdr3, "a");
+    // the size is found with the same line classification
+    EXPECT_THROW(header_size("a b c\n1 2 3\n"), ParseError);
+
+    // the headers read from buffer are independent
+    std::size_t size1{0};
+    auto hdr1 = ECSVHeader::read_view(apt_header, &size1);
+    auto hdr2 = ECSVHeader::read_view(apt_header);
+    EXPECT_EQ(size1, size);
+    EXPECT_TRUE(hdr1.is_compatible(hdr2));
+    EXPECT_EQ(hdr2.schema(), "astropy-2.0");
+    EXPECT_NE(&hdr1.meta(), &hdr2.meta());
+    auto meta = hdr1.meta();
+    meta["test_key"] = 1;
+    EXPECT_FALSE(hdr2.meta()["test_key"]);
 }
 
 TEST(ecsv, hdr) {
@@ -216,6 +301,57 @@ TEST(ecsv, array_data) {
     EXPECT_EQ(data2.row(0).size(), data2.size());
 }
 
+TEST(ecsv, array_data_growth) {
+
+    using namespace tula::ecsv;
+    std::stringstream content;
+    content << apt_header;
+    auto hdr = ECSVHeader::read(content);
+    auto cols = std::vector<std::string>{"x", "y"};
+    constexpr std::size_t bs = 16;
+
+    auto data0 = ArrayData<double, bs, Eigen::ColMajor, GrowthPolicy::block>{
+        hdr, cols};
+    EXPECT_TRUE(data0.ensure_row_size_for_index(bs));
+    EXPECT_EQ(data0.row_size(), 2 * bs);
+    EXPECT_FALSE(data0.ensure_row_size_for_index(2 * bs - 1));
+    EXPECT_TRUE(data0.ensure_row_size_for_index(2 * bs));
+    EXPECT_EQ(data0.row_size(), 3 * bs);
+
+    auto data1 =
+        ArrayData<double, bs, Eigen::ColMajor, GrowthPolicy::geometric>{hdr,
+                                                                        cols};
+    EXPECT_TRUE(data1.ensure_row_size_for_index(bs));
+    EXPECT_EQ(data1.row_size(), 2 * bs);
+    EXPECT_TRUE(data1.ensure_row_size_for_index(2 * bs));
+    EXPECT_EQ(data1.row_size(), 4 * bs);
+
+    auto data2 = ArrayData<double, bs, Eigen::ColMajor, GrowthPolicy::exact>{
+        hdr, cols};
+    // exact growth only with row count hint, and geometric without
+    EXPECT_TRUE(data2.ensure_row_size_for_index(bs));
+    EXPECT_EQ(data2.row_size(), 2 * bs);
+    EXPECT_FALSE(data2.reserve(bs));
+    EXPECT_TRUE(data2.ensure_row_size_for_index(2 * bs));
+    EXPECT_EQ(data2.row_size(), 2 * bs + 1);
+
+    // reserve allocates exactly and never shrinks
+    EXPECT_TRUE(data1.reserve(100));
+    EXPECT_EQ(data1.row_size(), 100);
+    EXPECT_FALSE(data1.reserve(10));
+    EXPECT_FALSE(data1.ensure_row_size_for_index(99));
+
+    // the row count hint is an upper bound and the table is truncated
+    auto [shdr, rows] = make_synthetic_table(10, 3);
+    auto tbl = ECSVTable(shdr);
+    tbl.load_rows(rows, 20);
+    EXPECT_EQ(tbl.rows(), 10);
+    EXPECT_EQ(tbl.col<int64_t>("c0")(9), 27);
+    EXPECT_EQ(count_lines(""), 0);
+    EXPECT_EQ(count_lines("a\nb"), 2);
+    EXPECT_EQ(count_lines("a\nb\n"), 2);
+}
+
 TEST(ecsv, dataloader) {
 
     using namespace tula::ecsv;
@@ -241,6 +377,18 @@ TEST(ecsv, dataloader) {
     loader.visit_col("nw", [](auto colref) {
         fmtlog("col: {} {}", colref.col, colref.data);
     });
+    // the plan has one entry per data col, ordered by hdr col
+    EXPECT_EQ(loader.plan().size(), data0.size() + data1.size() + data2.size());
+    EXPECT_TRUE(std::is_sorted(
+        loader.plan().begin(), loader.plan().end(),
+        [](auto &a, auto &b) { return a.field_idx < b.field_idx; }));
+    loader.ensure_row_size_for_index(1);
+    std::vector<std::string> fields(hdr.size(), "2");
+    fields[0] = "uid_1";
+    loader.decode_row(1, fields);
+    EXPECT_EQ(data0("nw")(1), 2.);
+    EXPECT_EQ(data1("nw")(1), 2);
+    EXPECT_EQ(data2("uid")(1), "uid_1");
 
     fmtlog("data0{}", data0.array());
     fmtlog("data1{}", data1.array());
@@ -323,4 +471,2181 @@ TEST(ecsv, table) {
     fmtlog("col data x{}", tbl.col<double>("x").data);
 }
 
+TEST(ecsv, decode_field) {
+
+    using namespace tula::ecsv;
+
+    int64_t i64{0};
+    EXPECT_TRUE(decode_field("-42", i64));
+    EXPECT_EQ(i64, -42);
+    EXPECT_TRUE(decode_field(" +7 ", i64));
+    EXPECT_EQ(i64, 7);
+    EXPECT_FALSE(decode_field("7x", i64));
+    EXPECT_EQ(i64, 0);
+    EXPECT_FALSE(decode_field("+-5", i64));
+    EXPECT_FALSE(decode_field("++5", i64));
+    int8_t i8{0};
+    EXPECT_TRUE(decode_field("-12", i8));
+    EXPECT_EQ(i8, -12);
+    uint16_t u16{0};
+    EXPECT_FALSE(decode_field("70000", u16));
+
+    double d{0};
+    EXPECT_TRUE(decode_field("-61920.816", d));
+    EXPECT_DOUBLE_EQ(d, -61920.816);
+    EXPECT_TRUE(decode_field("1e-3", d));
+    EXPECT_DOUBLE_EQ(d, 1e-3);
+    EXPECT_TRUE(decode_field("nan", d));
+    EXPECT_TRUE(std::isnan(d));
+    EXPECT_FALSE(decode_field("", d));
+    EXPECT_TRUE(std::isnan(d));
+    float f{0};
+    EXPECT_TRUE(decode_field("0.51677", f));
+    EXPECT_FLOAT_EQ(f, 0.51677F);
+    long double ld{0};
+    EXPECT_TRUE(decode_field("0.10999999999999999", ld));
+    EXPECT_NEAR(static_cast<double>(ld), 0.11, 1e-12);
+    // long double is parsed the same way as the other floating types
+    for (auto text : {"0x1p3", "1,5", "inf0", "--1", "+-1", "+ 1", "1e99999"}) {
+        EXPECT_FALSE(decode_field(text, ld)) << text;
+        EXPECT_FALSE(decode_field(text, d)) << text;
+    }
+    EXPECT_TRUE(decode_field("-1.5e300", ld));
+    EXPECT_EQ(ld, -1.5e300L);
+    EXPECT_TRUE(decode_field("+2.5", ld));
+    EXPECT_EQ(ld, 2.5L);
+    EXPECT_TRUE(decode_field("-inf", ld));
+    EXPECT_TRUE(std::isinf(ld));
+
+    bool b{false};
+    EXPECT_TRUE(decode_field("True", b));
+    EXPECT_TRUE(b);
+    EXPECT_TRUE(decode_field("0", b));
+    EXPECT_FALSE(b);
+    EXPECT_FALSE(decode_field("maybe", b));
+
+    std::complex<double> c{};
+    EXPECT_TRUE(decode_field("(1.5,-2)", c));
+    EXPECT_EQ(c, std::complex<double>(1.5, -2));
+    EXPECT_TRUE(decode_field("(1e-3-2.5j)", c));
+    EXPECT_EQ(c, std::complex<double>(1e-3, -2.5));
+    EXPECT_TRUE(decode_field("-3j", c));
+    EXPECT_EQ(c, std::complex<double>(0, -3));
+    EXPECT_TRUE(decode_field("4", c));
+    EXPECT_EQ(c, std::complex<double>(4, 0));
+
+    std::string str;
+    EXPECT_TRUE(decode_field("00_0_169_0", str));
+    EXPECT_EQ(str, "00_0_169_0");
+}
+
+TEST(ecsv, encode_field) {
+
+    using namespace tula::ecsv;
+
+    auto encode = [](const auto &value) {
+        std::string out;
+        encode_field(out, value);
+        return out;
+    };
+    EXPECT_EQ(encode(int64_t{-42}), "-42");
+    EXPECT_EQ(encode(int8_t{-12}), "-12");
+    EXPECT_EQ(encode(uint16_t{65535}), "65535");
+    EXPECT_EQ(encode(0.1), "0.1");
+    EXPECT_EQ(encode(-61920.816), "-61920.816");
+    EXPECT_EQ(encode(0.51677F), "0.51677");
+    EXPECT_EQ(encode(true), "True");
+    EXPECT_EQ(encode(false), "False");
+    EXPECT_EQ(encode(std::complex<double>(1e-3, -2.5)), "(0.001-2.5j)");
+    EXPECT_EQ(encode(std::complex<double>(1, 2)), "(1+2j)");
+    EXPECT_EQ(encode(std::string{"00_0_169_0"}), "00_0_169_0");
+    EXPECT_EQ(encode(std::string{}), "\"\"");
+    EXPECT_EQ(encode(std::string{"a \"b\""}), "\"a \"\"b\"\"\"");
+
+    // round trip
+    auto round_trip = [&encode](const auto &value) {
+        auto decoded = value;
+        EXPECT_TRUE(decode_field(encode(value), decoded));
+        return decoded;
+    };
+    EXPECT_EQ(round_trip(1e-300), 1e-300);
+    EXPECT_EQ(round_trip(0.10000000000000002), 0.10000000000000002);
+    EXPECT_EQ(round_trip(std::numeric_limits<int64_t>::min()),
+              std::numeric_limits<int64_t>::min());
+    EXPECT_EQ(round_trip(std::complex<double>(-0.5, 1e10)),
+              std::complex<double>(-0.5, 1e10));
+    EXPECT_EQ(round_trip(1.1L), 1.1L);
+}
+
+TEST(ecsv, table_values) {
+
+    using namespace tula::ecsv;
+    std::stringstream content;
+    content << apt_header;
+    auto tbl = ECSVTable(ECSVHeader::read(content));
+    auto parser =
+        aria::csv::CsvParser(content).delimiter(tbl.header().delimiter());
+    tbl.load_rows(parser);
+
+    EXPECT_EQ(tbl.rows(), 2);
+    EXPECT_EQ(tbl.col<std::string>("uid")(1), "00_1_159_1");
+    EXPECT_EQ(tbl.col<int32_t>("nw")(0), 0);
+    EXPECT_EQ(tbl.col<int64_t>("k")(1), 525);
+    EXPECT_DOUBLE_EQ(tbl.col<double>("y")(0), -61920.816);
+    EXPECT_DOUBLE_EQ(tbl.col<double>("f")(1), 0.873886);
+    EXPECT_EQ(tbl.col<std::string>("flag_summary")(0), "dark");
+    EXPECT_THROW(tbl.col<double>("nw"), std::runtime_error);
+}
+
+/// @brief Write \p content to file in the temp dir and return the path.
+auto write_temp_file(const std::string &name, const std::string &content) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream fo(path);
+    fo << content;
+    return path;
+}
+
+TEST(ecsv, header_size) {
+
+    using namespace tula::ecsv;
+    std::string_view content{apt_header};
+    auto offset = header_size(content);
+    EXPECT_TRUE(content.substr(offset).starts_with("00_0_169_0 "));
+    EXPECT_TRUE(content.substr(0, offset).ends_with("flag_summary\n"));
+
+    // CRLF file with blank comment line in the header
+    std::string crlf = "# %ECSV 1.0\r\n# ---\r\n#\r\n# datatype:\r\n"
+                       "# - {name: a, datatype: int64}\r\na\r\n1\r\n2\r\n";
+    auto path = write_temp_file("tula_test_ecsv_crlf.ecsv", crlf);
+    auto tbl = ECSVTable::from_mmap(path);
+    EXPECT_EQ(tbl.rows(), 2);
+    EXPECT_EQ(tbl.col<int64_t>("a")(1), 2);
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, tokenizer) {
+
+    using namespace tula::ecsv;
+    std::string_view data = "a b c\r\n\n1 \"x \"\"y\"\"\" 3\n"
+                            "\"multi\nline\"  \n4 5 6";
+    auto tokenizer = ECSVTokenizer(data, ' ');
+    std::vector<std::vector<std::string>> rows;
+    for (const auto &row : tokenizer) {
+        rows.emplace_back(row.begin(), row.end());
+    }
+    ASSERT_EQ(rows.size(), 4);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_EQ(rows[1], (std::vector<std::string>{"1", "x \"y\"", "3"}));
+    EXPECT_EQ(rows[2], (std::vector<std::string>{"multi\nline", "", ""}));
+    EXPECT_EQ(rows[3], (std::vector<std::string>{"4", "5", "6"}));
+
+    auto tokenizer_csv = ECSVTokenizer("1,,3\n", ',');
+    ECSVTokenizer::fields_t fields;
+    EXPECT_TRUE(tokenizer_csv.next(fields));
+    EXPECT_EQ(fields.size(), 3);
+    EXPECT_TRUE(fields[1].empty());
+    EXPECT_FALSE(tokenizer_csv.next(fields));
+
+    auto tokenizer_bad = ECSVTokenizer("\"abc\n", ' ');
+    EXPECT_THROW(tokenizer_bad.next(fields), ParseError);
+}
+
+TEST(ecsv, tokenizer_classify) {
+
+    using namespace tula::ecsv;
+    fmtlog("classify with {}", internal::default_classify.first);
+    std::string block(internal::classify_block_size * 4, 'x');
+    for (std::size_t i = 0; i < block.size(); i += 7) {
+        block[i] = (i % 3 == 0) ? '\n' : ((i % 3 == 1) ? ' ' : ',');
+    }
+    for (std::size_t i = 5; i < block.size(); i += 11) {
+        block[i] = '"';
+    }
+    for (std::size_t i = 0; i < block.size();
+         i += internal::classify_block_size) {
+        auto expected = internal::classify_scalar(block.data() + i, ' ');
+        EXPECT_NE(expected.field_end, 0);
+        EXPECT_NE(expected.quote, 0);
+        EXPECT_EQ(expected.field_end & expected.quote, 0);
+        EXPECT_TRUE(internal::default_classify.second(block.data() + i,
+                                                      ' ') == expected);
+    }
+    EXPECT_EQ(internal::classify_scalar(block.data(), ' ').quote,
+              (std::uint64_t(1) << 5) | (std::uint64_t(1) << 16) |
+                  (std::uint64_t(1) << 27) | (std::uint64_t(1) << 38) |
+                  (std::uint64_t(1) << 49) | (std::uint64_t(1) << 60));
+    // the long rows cross the block boundaries
+    auto [hdr, rows] = make_synthetic_table(100, 7);
+    std::string data;
+    for (const auto &row : rows) {
+        data += fmt::format("{}\n", fmt::join(row, ","));
+    }
+    data += "\"a,\n\"\"b\",,"; // last row has no newline
+    for (auto classify : {internal::default_classify.second,
+                          internal::classify_t{&internal::classify_scalar}}) {
+        auto tokenizer = ECSVTokenizer(data, ',', classify);
+        std::size_t i = 0;
+        for (const auto &row : tokenizer) {
+            if (i < rows.size()) {
+                EXPECT_TRUE(std::ranges::equal(row, rows[i]));
+            } else {
+                EXPECT_EQ(row, (ECSVTokenizer::fields_t{"a,\n\"b", "", ""}));
+            }
+            ++i;
+        }
+        EXPECT_EQ(i, rows.size() + 1);
+    }
+}
+
+TEST(ecsv, table_from_mmap) {
+
+    using namespace tula::ecsv;
+    auto path = write_temp_file("tula_test_ecsv_mmap.ecsv", apt_header);
+    auto tbl = ECSVTable::from_mmap(path);
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(tbl.rows(), 2);
+    EXPECT_EQ(tbl.header().cols()[0].name, "uid");
+    EXPECT_EQ(tbl.col<std::string>("uid")(0), "00_0_169_0");
+    EXPECT_EQ(tbl.col<int64_t>("loc")(1), 159);
+    EXPECT_DOUBLE_EQ(tbl.col<double>("x")(1), -13750);
+    EXPECT_EQ(tbl.col<std::string>("flag_summary")(1), "active");
+    fmtlog("tbl_info:\n{}", tbl.info());
+
+    // the table stays valid after move
+    auto tbl2 = std::move(tbl);
+    EXPECT_EQ(tbl2.col<int64_t>("loc")(0), 169);
+    EXPECT_EQ(tbl2.header_view().col("uid").name, "uid");
+}
+
+TEST(ecsv, split_chunks) {
+
+    using namespace tula::ecsv;
+    std::string_view data = "1 \"a\nb\"\n2 \"c\"\n3 \"\n\n\"\n4 d\n";
+    for (std::size_t n = 1; n < 8; ++n) {
+        auto chunks = internal::split_chunks(data, n);
+        std::string joined;
+        std::size_t n_rows = 0;
+        for (const auto &chunk : chunks) {
+            joined += chunk;
+            auto tokenizer = ECSVTokenizer(chunk, ' ');
+            for (const auto &row : tokenizer) {
+                EXPECT_EQ(row.size(), 2);
+                ++n_rows;
+            }
+        }
+        EXPECT_EQ(joined, data);
+        EXPECT_EQ(n_rows, 4);
+    }
+}
+
+TEST(ecsv, table_parallel) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "id name x\n";
+    constexpr std::size_t n_rows = 1000;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        if (i % 7 == 0) {
+            ss << fmt::format("{} \"row\n{}\" {}\n", i, i, 0.5 * i);
+        } else {
+            ss << fmt::format("{} row{} {}\n", i, i, 0.5 * i);
+        }
+    }
+    auto path = write_temp_file("tula_test_ecsv_parallel.ecsv", ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto tbl = from_mmap_parallel(path, tula::grppi_utils::default_mode_name(),
+                                  16);
+    std::filesystem::remove(path);
+
+    ASSERT_EQ(tbl.rows(), n_rows);
+    EXPECT_TRUE(
+        (tbl.col<int64_t>("id").data == tbl0.col<int64_t>("id").data).all());
+    EXPECT_TRUE(
+        (tbl.col<double>("x").data == tbl0.col<double>("x").data).all());
+    EXPECT_EQ(tbl.col<std::string>("name").data,
+              tbl0.col<std::string>("name").data);
+    EXPECT_EQ(tbl.col<std::string>("name")(7), "row\n7");
+    EXPECT_EQ(tbl.col<int64_t>("id")(n_rows - 1), n_rows - 1);
+
+    // errors in chunks are rethrown with the row in the whole data
+    auto bad = ss.str() + "1000 row1000\n1001 row1001 0.5\n";
+    std::size_t data_offset{0};
+    auto tbl1 = ECSVTable(ECSVHeader::read_view(bad, &data_offset));
+    try {
+        load_rows_parallel(tbl1, std::string_view(bad).substr(data_offset),
+                           tula::grppi_utils::default_mode_name(), 16);
+        FAIL() << "expected RowParseError";
+    } catch (const RowParseError &e) {
+        EXPECT_EQ(e.row, n_rows);
+    }
+    auto bad_quote = ss.str() + "1000 \"row1000 0.5\n";
+    auto tbl2 = ECSVTable(ECSVHeader::read_view(bad_quote, &data_offset));
+    EXPECT_THROW(
+        load_rows_parallel(tbl2,
+                           std::string_view(bad_quote).substr(data_offset),
+                           tula::grppi_utils::default_mode_name(), 16),
+        ParseError);
+}
+
+TEST(ecsv, table_concat) {
+
+    using namespace tula::ecsv;
+    auto dir = std::filesystem::temp_directory_path() / "tula_test_ecsv_concat";
+    std::filesystem::create_directories(dir);
+    std::string hdr = "# %ECSV 0.9\n# ---\n# datatype:\n"
+                      "# - {name: id, datatype: int64}\n"
+                      "# - {name: name, datatype: string}\n"
+                      "id name\n";
+    constexpr std::size_t n_files = 5;
+    std::size_t n_rows = 0;
+    for (std::size_t f = 0; f < n_files; ++f) {
+        std::ofstream fo(dir / fmt::format("part_{}.ecsv", f));
+        fo << hdr;
+        for (std::size_t i = 0; i < f * 10; ++i, ++n_rows) {
+            fo << fmt::format("{} \"row\n{}\"\n", n_rows, n_rows);
+        }
+    }
+    auto paths =
+        tula::filename_utils::find_regex(dir.string(), "part_\\d+\\.ecsv");
+    std::sort(paths.begin(), paths.end());
+    ASSERT_EQ(paths.size(), n_files);
+    auto tbl = from_mmap_concat(paths);
+    ASSERT_EQ(tbl.rows(), n_rows);
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        EXPECT_EQ(tbl.col<int64_t>("id")(i), i);
+    }
+    EXPECT_EQ(tbl.col<std::string>("name")(n_rows - 1),
+              fmt::format("row\n{}", n_rows - 1));
+    auto tbl1 =
+        from_mmap_concat<TableLayout::row_major, StringStorage::arena>(
+            paths, "seq", std::vector<std::string>{"name"});
+    EXPECT_EQ(tbl1.cols(), 1);
+    EXPECT_EQ(tbl1.col<std::string_view>("name")(10), "row\n10");
+
+    // incompatible header
+    {
+        std::ofstream fo(dir / "part_9.ecsv");
+        fo << "# %ECSV 0.9\n# ---\n# datatype:\n"
+              "# - {name: id, datatype: float64}\n"
+              "# - {name: name, datatype: string}\n"
+              "id name\n1.5 a\n";
+    }
+    paths.push_back((dir / "part_9.ecsv").string());
+    EXPECT_THROW(from_mmap_concat(paths, "seq"), std::runtime_error);
+    EXPECT_THROW(from_mmap_concat({}), std::runtime_error);
+    // the errors in the workers are rethrown with the file name
+    auto expect_error = [&](const std::vector<std::string> &paths_,
+                            const std::string &what) {
+        try {
+            from_mmap_concat(paths_);
+            FAIL() << "expected error " << what;
+        } catch (const std::runtime_error &e) {
+            EXPECT_NE(std::string_view(e.what()).find(what),
+                      std::string_view::npos)
+                << e.what();
+        }
+    };
+    paths.pop_back();
+    expect_error({paths[1], paths.back(), paths[0] + ".missing"},
+                 ".missing");
+    expect_error({paths[1], (dir / "part_9.ecsv").string()}, "part_9.ecsv");
+    {
+        std::ofstream fo(dir / "part_8.ecsv");
+        fo << hdr << "1 a\n2\n";
+    }
+    try {
+        from_mmap_concat({paths[1], (dir / "part_8.ecsv").string()});
+        FAIL() << "expected RowParseError";
+    } catch (const RowParseError &e) {
+        EXPECT_EQ(e.row, 1);
+        EXPECT_NE(e.reason.find("part_8.ecsv"), std::string::npos);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+#if TULA_ECSV_HAS_ZLIB
+/// @brief Write \p content gzip-compressed to file in the temp dir and
+/// return the path.
+auto write_temp_gzip_file(const std::string &name,
+                          const std::string &content, bool append = false) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    auto *fo = gzopen(path.c_str(), append ? "ab" : "wb");
+    gzwrite(fo, content.data(), static_cast<unsigned>(content.size()));
+    gzclose(fo);
+    return path;
+}
+
+TEST(ecsv, table_gzip) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "id name x\n";
+    constexpr std::size_t n_rows = 1000;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        if (i % 7 == 0) {
+            ss << fmt::format("{} \"row\n\"\"{}\"\"\" {}\n", i, i, 0.5 * i);
+        } else {
+            ss << fmt::format("{} row{} {}\n\n", i, i, 0.5 * i);
+        }
+    }
+    auto path = write_temp_file("tula_test_ecsv_gzip.ecsv", ss.str());
+    auto gzpath = write_temp_gzip_file("tula_test_ecsv_gzip.ecsv.gz",
+                                       ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto tbl = ECSVTable::from_mmap(gzpath);
+    ASSERT_EQ(tbl.rows(), n_rows);
+    EXPECT_TRUE(
+        (tbl.col<double>("x").data == tbl0.col<double>("x").data).all());
+    EXPECT_EQ(tbl.col<std::string>("name").data,
+              tbl0.col<std::string>("name").data);
+
+    // small blocks with rows across the block boundaries
+    auto file = tula::mmap_utils::MappedFile(gzpath);
+    for (auto threaded : {true, false}) {
+        for (std::size_t block_size : {1, 7, 64, 1000}) {
+            auto rows = ECSVGzipRows(file.view(), block_size, threaded);
+            EXPECT_EQ(rows.header_text(),
+                      ss.str().substr(0, header_size(ss.str())));
+            auto tbl1 = ECSVTable(rows.header());
+            tbl1.load_rows(rows);
+            ASSERT_EQ(tbl1.rows(), n_rows);
+            EXPECT_EQ(tbl1.col<std::string>("name").data,
+                      tbl0.col<std::string>("name").data);
+        }
+    }
+    // concatenated members
+    write_temp_gzip_file("tula_test_ecsv_gzip.ecsv.gz", "1 a 1.5\n", true);
+    auto tbl2 = ECSVTable::from_mmap(gzpath);
+    ASSERT_EQ(tbl2.rows(), n_rows + 1);
+    EXPECT_EQ(tbl2.col<std::string>("name")(n_rows), "a");
+    // streaming and cache
+    std::size_t n_streamed = 0;
+    stream_mmap(gzpath, [&](auto &reader) { n_streamed += reader.rows(); },
+                std::vector<std::string>{"x"}, 100);
+    EXPECT_EQ(n_streamed, n_rows + 1);
+    auto cachepath = cache::default_path(gzpath);
+    std::filesystem::remove(cachepath);
+    from_mmap_cached(gzpath);
+    EXPECT_EQ(from_mmap_cached(gzpath).rows(), n_rows + 1);
+    std::filesystem::remove(cachepath);
+    // concat of compressed and plain files, and parallel loading
+    auto tbl3 = from_mmap_concat({gzpath, path, gzpath});
+    ASSERT_EQ(tbl3.rows(), 3 * n_rows + 2);
+    EXPECT_EQ(tbl3.col<std::string>("name")(2 * n_rows + 1),
+              tbl0.col<std::string>("name")(0));
+    EXPECT_EQ(from_mmap_parallel(gzpath).rows(), n_rows + 1);
+    // unsupported paths
+    EXPECT_THROW(ECSVTable::from_mmap_lazy(gzpath), std::runtime_error);
+    EXPECT_THROW(row_index(gzpath), std::runtime_error);
+    EXPECT_THROW(from_mmap_slice(gzpath, row_index(path),
+                                 tula::container_utils::parse_slice("::2")),
+                 std::runtime_error);
+    {
+        std::ifstream is(gzpath, std::ios::binary);
+        EXPECT_THROW(ECSVHeader::read(is), ParseError);
+    }
+    // truncated data
+    auto content = std::string{file.view()};
+    auto trpath = write_temp_file("tula_test_ecsv_gzip_truncated.ecsv.gz",
+                                  content.substr(0, content.size() / 2));
+    EXPECT_THROW(ECSVTable::from_mmap(trpath), ParseError);
+    std::filesystem::remove(trpath);
+    std::filesystem::remove(gzpath);
+    std::filesystem::remove(path);
+}
+#endif
+
+TEST(ecsv, table_projection) {
+
+    using namespace tula::ecsv;
+    auto path = write_temp_file("tula_test_ecsv_projection.ecsv", apt_header);
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto tbl = ECSVTable::from_mmap(path, std::vector<std::string>{"y", "uid"});
+    EXPECT_EQ(tbl.cols(), 2);
+    EXPECT_EQ(tbl.header().size(), tbl0.cols());
+    EXPECT_EQ(tbl.header_view().colnames(),
+              (std::vector<std::string>{"y", "uid"}));
+    // skipped columns are not in the decode plan
+    EXPECT_EQ(tbl.loader().plan().size(), 2);
+    ASSERT_EQ(tbl.rows(), tbl0.rows());
+    EXPECT_TRUE(
+        (tbl.col<double>("y").data == tbl0.col<double>("y").data).all());
+    EXPECT_EQ(tbl.col<std::string>("uid").data,
+              tbl0.col<std::string>("uid").data);
+    EXPECT_THROW(tbl.col<double>("x"), std::runtime_error);
+    EXPECT_EQ(tbl.array_data<int64_t>().size(), 0);
+
+    auto tbl1 = ECSVTable::from_mmap(
+        path, [](const auto &col) { return col.datatype == "int64"; });
+    EXPECT_EQ(tbl1.cols(), 8);
+    EXPECT_EQ(tbl1.col<int64_t>("k")(1), tbl0.col<int64_t>("k")(1));
+    std::filesystem::remove(path);
+
+    // write the loaded columns only
+    std::stringstream ss;
+    ECSVWriter(ss).write(tbl);
+    auto hdr = ECSVHeader::read(ss);
+    EXPECT_EQ(hdr.size(), 2);
+    EXPECT_EQ(hdr.cols()[0].name, "y");
+}
+
+TEST(ecsv, table_stream) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "id name x\n";
+    constexpr std::size_t n_rows = 1000;
+    constexpr std::size_t batch_size = 64;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        ss << fmt::format("{} row{} {}\n", i, i, 0.5 * i);
+    }
+    auto path = write_temp_file("tula_test_ecsv_stream.ecsv", ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+
+    std::size_t n_batches{0};
+    std::size_t n_rows_read{0};
+    double sum{0};
+    stream_mmap(
+        path,
+        [&](auto &reader) {
+            EXPECT_EQ(reader.row_offset(), n_rows_read);
+            auto x = reader.template col<double>("x");
+            auto id = reader.template col<int64_t>("id");
+            ASSERT_EQ(x.data.size(), reader.rows());
+            EXPECT_EQ(id(0), n_rows_read);
+            EXPECT_THROW(reader.template col<std::string>("name"),
+                         std::runtime_error);
+            sum += x.data.sum();
+            n_rows_read += reader.rows();
+            ++n_batches;
+        },
+        std::vector<std::string>{"x", "id"}, batch_size);
+    std::filesystem::remove(path);
+    EXPECT_EQ(n_rows_read, n_rows);
+    EXPECT_EQ(n_batches, (n_rows + batch_size - 1) / batch_size);
+    EXPECT_EQ(sum, tbl0.col<double>("x").data.sum());
+
+    // projection with predicate, reading batches manually
+    auto buf = ss.str();
+    auto data_offset = header_size(buf);
+    std::istringstream is{buf.substr(0, data_offset)};
+    auto reader = ECSVStreamReader(
+        ECSVHeader::read(is),
+        [](const auto &col) { return col.datatype == "string"; }, 300);
+    EXPECT_EQ(reader.header_view().colnames(),
+              (std::vector<std::string>{"name"}));
+    auto rows = ECSVTokenizer(std::string_view{buf}.substr(data_offset));
+    EXPECT_EQ(reader.read_batch(rows), 300);
+    EXPECT_EQ(reader.read_batch(rows), 300);
+    EXPECT_EQ(reader.col<std::string>("name")(0), "row300");
+    EXPECT_EQ(reader.read_batch(rows), 300);
+    EXPECT_EQ(reader.read_batch(rows), 100);
+    EXPECT_EQ(reader.col<std::string>("name")(99), "row999");
+    EXPECT_EQ(reader.read_batch(rows), 0);
+}
+
+TEST(ecsv, table_cache) {
+
+    using namespace tula::ecsv;
+    auto path = write_temp_file("tula_test_ecsv_cache.ecsv", apt_header);
+    auto cachepath = cache::default_path(path);
+    std::filesystem::remove(cachepath);
+    auto tbl0 = from_mmap_cached(path);
+    ASSERT_TRUE(std::filesystem::exists(cachepath));
+    auto hdr_text = std::string{apt_header}.substr(0, header_size(apt_header));
+    auto key = cache::make_key(path, hdr_text);
+    auto tbl = cache::read(cachepath, key);
+    ASSERT_TRUE(tbl.has_value());
+    ASSERT_EQ(tbl->rows(), tbl0.rows());
+    EXPECT_TRUE(tbl->header().is_compatible(tbl0.header()));
+    EXPECT_EQ(tbl->col<std::string>("uid").data,
+              tbl0.col<std::string>("uid").data);
+    EXPECT_EQ(tbl->col<std::string>("flag_summary")(1), "active");
+    EXPECT_TRUE(
+        (tbl->col<int32_t>("nw").data == tbl0.col<int32_t>("nw").data).all());
+    EXPECT_TRUE(
+        (tbl->col<double>("f").data == tbl0.col<double>("f").data).all());
+    // any change of the key invalidates the cache
+    key.size += 1;
+    EXPECT_FALSE(cache::read(cachepath, key).has_value());
+    // the cache write is best-effort
+    auto badpath = (std::filesystem::temp_directory_path() /
+                    "tula_test_no_such_dir" / "cache")
+                       .string();
+    EXPECT_THROW(cache::write(tbl0, hdr_text, key, badpath),
+                 std::runtime_error);
+    EXPECT_EQ(from_mmap_cached(path, badpath).rows(), tbl0.rows());
+    // the truncated cache is a miss, and is overwritten
+    key.size -= 1;
+    auto cache_size = std::filesystem::file_size(cachepath);
+    std::filesystem::resize_file(cachepath, cache_size / 2);
+    EXPECT_THROW(cache::read(cachepath, key), std::runtime_error);
+    auto tbl1 = from_mmap_cached(path);
+    EXPECT_EQ(tbl1.col<std::string>("uid").data,
+              tbl0.col<std::string>("uid").data);
+    EXPECT_EQ(std::filesystem::file_size(cachepath), cache_size);
+    EXPECT_TRUE(cache::read(cachepath, key).has_value());
+    std::filesystem::remove(path);
+    std::filesystem::remove(cachepath);
+}
+
+TEST(ecsv, string_arena) {
+
+    using namespace tula::ecsv;
+    auto arena = StringArena(4);
+    EXPECT_EQ(arena.size(), 4);
+    EXPECT_EQ(arena[3], "");
+    arena.set(0, "a");
+    arena.set(2, "ccc");
+    EXPECT_EQ(arena.filled(), 3);
+    EXPECT_EQ(arena[1], "");
+    EXPECT_EQ(arena[2], "ccc");
+    EXPECT_EQ(arena.bytes(), "accc");
+    // setting an earlier row discards the later rows
+    arena.set(1, "bb");
+    EXPECT_EQ(arena.filled(), 2);
+    EXPECT_EQ(arena[2], "");
+    EXPECT_EQ(arena.bytes(), "abb");
+    arena.resize(1);
+    EXPECT_EQ(arena.bytes(), "a");
+    arena.resize(3);
+    auto other = StringArena(2);
+    other.set(0, "x");
+    arena.assign_rows(1, other, other.size());
+    EXPECT_EQ(arena.filled(), 3);
+    EXPECT_TRUE(std::ranges::equal(arena, std::vector<std::string_view>{
+                                              "a", "x", ""}));
+
+    std::stringstream content;
+    content << apt_header;
+    auto hdr = ECSVHeader::read(content);
+    auto data = ArrayData<std::string_view>{hdr, [](const auto &col) {
+                                                return col.datatype ==
+                                                       dtype_str<std::string>();
+                                            }};
+    static_assert(std::is_same_v<decltype(data)::data_t,
+                                 std::vector<StringArena>>);
+    EXPECT_EQ(data.row_size(), decltype(data)::block_size);
+    auto colref = data("uid");
+    colref.set_value(0, std::string{"00_0_169_0"});
+    EXPECT_EQ(colref(0), "00_0_169_0");
+
+    auto path = write_temp_file("tula_test_ecsv_arena.ecsv", apt_header);
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto tbl = ECSVArenaTable::from_mmap(path);
+    static_assert(ECSVArenaTable::string_storage() == StringStorage::arena);
+    // the string columns are stored as the one string type of the table
+    static_assert(std::tuple_size_v<ECSVArenaTable::table_data_t> ==
+                  std::tuple_size_v<ECSVTable::table_data_t>);
+    static_assert(ECSVArenaTable::table_data_traits::dtype_index<
+                      std::string_view>() ==
+                  ECSVTable::table_data_traits::dtype_index<std::string>());
+    ASSERT_EQ(tbl.rows(), tbl0.rows());
+    EXPECT_TRUE(std::ranges::equal(tbl.col<std::string_view>("uid").data,
+                                   tbl0.col<std::string>("uid").data));
+    {
+        // the rows are not discarded by setting the rows before them
+        auto uid = tbl.col<std::string_view>("uid");
+        auto last = static_cast<Eigen::Index>(tbl.rows()) - 1;
+        EXPECT_THROW(uid.set_value(0, std::string_view{"x"}),
+                     std::runtime_error);
+        EXPECT_THROW(uid.decode_value(0, "x"), std::runtime_error);
+        EXPECT_EQ(uid(last), tbl0.col<std::string>("uid")(last));
+        EXPECT_EQ(uid(0), tbl0.col<std::string>("uid")(0));
+    }
+    EXPECT_EQ(tbl.col<std::string_view>("flag_summary")(1), "active");
+    EXPECT_TRUE(
+        (tbl.col<double>("f").data == tbl0.col<double>("f").data).all());
+    // projection
+    auto tblp =
+        ECSVArenaTable::from_mmap(path, std::vector<std::string>{"uid"});
+    EXPECT_EQ(tblp.cols(), 1);
+    EXPECT_EQ(tblp.col<std::string_view>("uid")(1), "00_1_159_1");
+    // write
+    std::stringstream ss;
+    ECSVWriter(ss).write(tbl);
+    auto tbl1 = ECSVTable(ECSVHeader::read(ss));
+    auto rows = aria::csv::CsvParser(ss).delimiter(' ');
+    tbl1.load_rows(rows);
+    EXPECT_EQ(tbl1.col<std::string>("uid").data,
+              tbl0.col<std::string>("uid").data);
+    // cache
+    auto cachepath = cache::default_path(path);
+    auto hdr_text = std::string{apt_header}.substr(0, header_size(apt_header));
+    auto key = cache::make_key(path, hdr_text);
+    cache::write(tbl, hdr_text, key, cachepath);
+    auto tblc = cache::read(cachepath, key);
+    ASSERT_TRUE(tblc.has_value());
+    EXPECT_EQ(tblc->col<std::string>("uid").data,
+              tbl0.col<std::string>("uid").data);
+    std::filesystem::remove(cachepath);
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, table_layout) {
+
+    using namespace tula::ecsv;
+    // more rows than the staging buffer, and not a multiple of it
+    constexpr std::size_t n_rows = 1000;
+    auto [hdr, rows] = make_synthetic_table(n_rows, 7);
+    auto tbl0 = ECSVTable(hdr);
+    tbl0.load_rows(rows);
+    auto check = [&](auto &tbl) {
+        ASSERT_EQ(tbl.rows(), n_rows);
+        for (const auto &col : hdr.cols()) {
+            if (col.datatype == dtype_str<int64_t>()) {
+                EXPECT_TRUE((tbl.template col<int64_t>(col.name).data ==
+                             tbl0.col<int64_t>(col.name).data)
+                                .all());
+            } else {
+                EXPECT_TRUE((tbl.template col<double>(col.name).data ==
+                             tbl0.col<double>(col.name).data)
+                                .all());
+            }
+        }
+    };
+    auto tbl1 = BasicECSVTable<TableLayout::row_major>(hdr);
+    tbl1.load_rows(rows);
+    check(tbl1);
+    // the values of a row are contiguous
+    EXPECT_EQ(tbl1.array_data<double>().col_data(0).second,
+              tbl1.array_data<double>().size());
+    auto tbl2 = BasicECSVTable<TableLayout::staged>(hdr);
+    tbl2.load_rows(rows, n_rows);
+    check(tbl2);
+    EXPECT_EQ(tbl2.array_data<double>().col_data(0).second, 1);
+
+    // strings and parallel loading
+    auto path = write_temp_file("tula_test_ecsv_layout.ecsv", apt_header);
+    auto tbl3 = ECSVTable::from_mmap(path);
+    {
+        auto tbl4 = BasicECSVTable<TableLayout::staged>::from_mmap(path);
+        ASSERT_EQ(tbl4.rows(), tbl3.rows());
+        EXPECT_TRUE(
+            (tbl4.col<double>("y").data == tbl3.col<double>("y").data).all());
+        EXPECT_EQ(tbl4.col<std::string>("uid").data,
+                  tbl3.col<std::string>("uid").data);
+        auto tbl4a = BasicECSVTable<TableLayout::staged,
+                                    StringStorage::arena>::from_mmap(path);
+        ASSERT_EQ(tbl4a.rows(), tbl3.rows());
+        EXPECT_EQ(tbl4a.col<std::string_view>("uid")(1), "00_1_159_1");
+    }
+    auto tbl5 = from_mmap_parallel<TableLayout::row_major>(path);
+    EXPECT_TRUE(
+        (tbl5.col<int32_t>("nw").data == tbl3.col<int32_t>("nw").data).all());
+    std::stringstream ss0;
+    std::stringstream ss1;
+    ECSVWriter(ss0).write(tbl3);
+    ECSVWriter(ss1).write(tbl5);
+    EXPECT_EQ(ss0.str(), ss1.str());
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, table_lazy) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "id name x\n";
+    constexpr std::size_t n_rows = 100;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        if (i % 7 == 0) {
+            ss << fmt::format("{} \"row \"\"{}\"\"\" {}\n", i, i, 0.5 * i);
+        } else {
+            ss << fmt::format("{} \"row{}\" {}\n\n", i, i, 0.5 * i);
+        }
+    }
+    auto path = write_temp_file("tula_test_ecsv_lazy.ecsv", ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto tbl = ECSVTable::from_mmap_lazy(path);
+    EXPECT_TRUE(tbl.is_lazy());
+    ASSERT_EQ(tbl.rows(), n_rows);
+    EXPECT_TRUE(
+        (tbl.col<double>("x").data == tbl0.col<double>("x").data).all());
+    EXPECT_EQ(tbl.col<std::string>("name")(7), "row \"7\"");
+    EXPECT_EQ(tbl.col<std::string>("name").data,
+              tbl0.col<std::string>("name").data);
+    // moved table keeps the decoded and undecoded columns
+    auto tbl1 = std::move(tbl);
+    EXPECT_TRUE((tbl1.col<int64_t>("id").data == tbl0.col<int64_t>("id").data)
+                    .all());
+    EXPECT_EQ(tbl1.col<double>("x")(3), 1.5);
+
+    auto tbl2 = ECSVArenaTable::from_mmap_lazy(
+        path, std::vector<std::string>{"name"});
+    EXPECT_EQ(tbl2.col<std::string_view>("name")(14), "row \"14\"");
+    EXPECT_THROW(tbl2.col<double>("x"), std::runtime_error);
+    std::stringstream ss0;
+    std::stringstream ss1;
+    ECSVWriter(ss0).write(ECSVTable::from_mmap_lazy(path));
+    ECSVWriter(ss1).write(tbl0);
+    EXPECT_EQ(ss0.str(), ss1.str());
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, table_slice) {
+
+    using namespace tula::ecsv;
+    using tula::container_utils::parse_slice;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "id name\n";
+    constexpr std::size_t n_rows = 100;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        if (i % 7 == 0) {
+            ss << fmt::format("{} \"row\n\"\"{}\"\"\"\n\n", i, i);
+        } else {
+            ss << fmt::format("{} row{}\n", i, i);
+        }
+    }
+    auto path = write_temp_file("tula_test_ecsv_slice.ecsv", ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto file = tula::mmap_utils::MappedFile(path);
+    auto data = file.view().substr(header_size(file.view()));
+    auto index = ECSVRowIndex::build(data, 8);
+    EXPECT_EQ(index.rows(), n_rows);
+    EXPECT_EQ(index.offsets().size(), 13U);
+    EXPECT_TRUE(data.substr(index.offsets()[1]).starts_with("8 row8\n"));
+    for (const auto &s : {":", "3:40:5", "95:", "-10::3", "7:8", "50:10"}) {
+        auto tbl = from_mmap_slice(path, index, parse_slice(s));
+        auto [start, stop, step, size] =
+            tula::container_utils::to_indices(parse_slice(s), n_rows);
+        ASSERT_EQ(tbl.rows(), size);
+        for (Eigen::Index i = 0; i < size; ++i) {
+            auto r = start + i * step;
+            EXPECT_EQ(tbl.col<int64_t>("id")(i), r);
+            EXPECT_EQ(tbl.col<std::string>("name")(i),
+                      tbl0.col<std::string>("name")(r));
+        }
+    }
+    EXPECT_THROW(from_mmap_slice(path, index, parse_slice("::-1")),
+                 std::runtime_error);
+    // staged layout and projection
+    auto tbl1 = from_mmap_slice<TableLayout::staged>(
+        path, index, parse_slice("1::2"), std::vector<std::string>{"name"});
+    EXPECT_EQ(tbl1.rows(), n_rows / 2);
+    EXPECT_EQ(tbl1.col<std::string>("name")(3), "row\n\"7\"");
+
+    // the index is saved and reused
+    auto indexpath = ECSVRowIndex::default_path(path);
+    std::filesystem::remove(indexpath);
+    auto index1 = row_index_cached(path, std::nullopt, 8);
+    EXPECT_TRUE(std::filesystem::exists(indexpath));
+    auto index2 = row_index_cached(path, std::nullopt, 8);
+    EXPECT_EQ(index2.rows(), n_rows);
+    EXPECT_EQ(index2.offsets(), index.offsets());
+    // the count of offsets is checked before allocating
+    auto key = cache::make_key(path, file.view().substr(
+                                         0, header_size(file.view())));
+    {
+        std::fstream fo(indexpath,
+                        std::ios::in | std::ios::out | std::ios::binary);
+        // the count is the last field of the index header
+        fo.seekp(ECSVRowIndex::magic.size() + 6 * sizeof(std::uint64_t));
+        auto count = std::numeric_limits<std::uint64_t>::max() / 4;
+        fo.write(reinterpret_cast<const char *>(&count), // NOLINT
+                 sizeof(count));
+    }
+    EXPECT_THROW(ECSVRowIndex::read(indexpath, key), std::runtime_error);
+    // the broken index is rebuilt and overwritten
+    EXPECT_EQ(row_index_cached(path, std::nullopt, 8).offsets(),
+              index.offsets());
+    ASSERT_TRUE(ECSVRowIndex::read(indexpath, key).has_value());
+    std::filesystem::resize_file(indexpath,
+                                 std::filesystem::file_size(indexpath) - 4);
+    EXPECT_THROW(ECSVRowIndex::read(indexpath, key), std::runtime_error);
+    EXPECT_EQ(row_index_cached(path, std::nullopt, 8).offsets(),
+              index.offsets());
+    EXPECT_EQ(ECSVRowIndex::read(indexpath, key)->offsets(), index.offsets());
+    std::filesystem::remove(indexpath);
+    // in-memory index, and best-effort save
+    EXPECT_EQ(row_index(path, 8).offsets(), index.offsets());
+    EXPECT_FALSE(std::filesystem::exists(indexpath));
+    auto badpath = (std::filesystem::temp_directory_path() /
+                    "tula_test_no_such_dir" / "index")
+                       .string();
+    EXPECT_EQ(row_index_cached(path, badpath, 8).rows(), n_rows);
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, table_stats) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "# - {name: flag, datatype: bool}\n"
+          "id name x flag\n";
+    constexpr std::size_t n_rows = 1000;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        if (i % 10 == 3) {
+            ss << fmt::format("{} row{} nan True\n", i, i);
+        } else {
+            ss << fmt::format("{} row{} {} False\n", i, i, 0.5 * i - 100.);
+        }
+    }
+    auto path = write_temp_file("tula_test_ecsv_stats.ecsv", ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+    EXPECT_EQ(tbl0.stats_policy(), ColumnStatsPolicy::skip);
+    auto x = tbl0.col<double>("x").data;
+    auto n_nan = (x.array() != x.array()).count();
+    auto x_valid = x.unaryExpr([](auto v) { return std::isnan(v) ? 0. : v; });
+    auto check_stats = [&](const ColumnStats &s) {
+        EXPECT_EQ(s.count, n_rows - std::size_t(n_nan));
+        EXPECT_EQ(s.nan_count, std::size_t(n_nan));
+        EXPECT_EQ(s.min, -100.);
+        EXPECT_EQ(s.max, 0.5 * (n_rows - 1) - 100.);
+        EXPECT_DOUBLE_EQ(s.sum, x_valid.sum());
+        auto n_valid = double(n_rows - std::size_t(n_nan));
+        auto mean = x_valid.sum() / n_valid;
+        EXPECT_DOUBLE_EQ(s.mean(), mean);
+        EXPECT_NEAR(s.var(), x_valid.square().sum() / n_valid - mean * mean,
+                    1e-9 * s.var());
+    };
+    // computed from the data
+    check_stats(tbl0.stats("x"));
+    EXPECT_EQ(tbl0.stats("id").count, n_rows);
+    EXPECT_EQ(tbl0.stats("id").nan_count, 0U);
+    EXPECT_DOUBLE_EQ(tbl0.stats("id").mean(), 0.5 * (n_rows - 1));
+    EXPECT_THROW(tbl0.stats("name"), std::runtime_error);
+    EXPECT_THROW(tbl0.stats("flag"), std::runtime_error);
+    // collected when loading
+    auto collect = ColumnStatsPolicy::collect;
+    auto tbl1 = ECSVTable::from_mmap(path, collect);
+    check_stats(tbl1.stats("x"));
+    EXPECT_EQ(tbl1.stats("id").sum, tbl0.stats("id").sum);
+    fmtlog("{}", tbl1.info());
+    EXPECT_NE(tbl1.info().find("Column Stats:"), std::string::npos);
+    auto tbl2 = std::move(tbl1);
+    check_stats(tbl2.stats("x"));
+
+    auto file = tula::mmap_utils::MappedFile(path);
+    auto data = file.view().substr(header_size(file.view()));
+    auto tbl3 = BasicECSVTable<TableLayout::staged>(
+        ECSVHeader::read_view(file.view()), std::vector<std::string>{"x"},
+        collect);
+    auto rows = ECSVTokenizer(data, ' ');
+    tbl3.load_rows(rows);
+    check_stats(tbl3.stats("x"));
+    EXPECT_THROW(tbl3.stats("id"), std::runtime_error);
+
+    auto tbl4 = ECSVTable(ECSVHeader::read_view(file.view()), collect);
+    load_rows_parallel(tbl4, data, "seq", 7);
+    check_stats(tbl4.stats("x"));
+
+    auto tbl5 = ECSVTable::from_mmap_lazy(path, collect);
+    EXPECT_NE(tbl5.info().find("not decoded"), std::string::npos);
+    check_stats(tbl5.stats("x"));
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, column_stats_offset) {
+    using namespace tula::ecsv;
+    // MJD-like values, whose squares lose the variance in double
+    constexpr double offset = 6e4;
+    ColumnStats all{};
+    ColumnStats a{};
+    ColumnStats b{};
+    constexpr int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        auto v = offset + 1e-4 * (i % 2 == 0 ? 1. : -1.);
+        all.add(v);
+        (i < n / 3 ? a : b).add(v);
+    }
+    a.merge(b);
+    a.merge(ColumnStats{});
+    for (const auto &s : {all, a}) {
+        EXPECT_EQ(s.count, std::size_t(n));
+        EXPECT_NEAR(s.mean(), offset, 1e-9);
+        EXPECT_NEAR(s.var(), 1e-8, 1e-14);
+    }
+    ColumnStats c{};
+    c.add(offset);
+    EXPECT_EQ(c.var(), 0.);
+    EXPECT_TRUE(std::isnan(ColumnStats{}.var()));
+
+    // the infinities are not in the mean and variance
+    constexpr auto inf = std::numeric_limits<double>::infinity();
+    ColumnStats d{};
+    ColumnStats e{};
+    for (auto v : {1., inf, 2.}) {
+        d.add(v);
+    }
+    for (auto v : {-inf, 3.}) {
+        e.add(v);
+    }
+    ColumnStats f{};
+    f.add(inf);
+    EXPECT_EQ(f.inf_count, 1U);
+    EXPECT_TRUE(std::isnan(f.mean()));
+    d.merge(e);
+    d.merge(f);
+    EXPECT_EQ(d.count, 6U);
+    EXPECT_EQ(d.inf_count, 3U);
+    EXPECT_EQ(d.finite_count(), 3U);
+    EXPECT_EQ(d.min, -inf);
+    EXPECT_EQ(d.max, inf);
+    EXPECT_DOUBLE_EQ(d.mean(), 2.);
+    EXPECT_DOUBLE_EQ(d.var(), 2. / 3.);
+}
+
+TEST(ecsv, table_filter) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "# - {name: flag, datatype: int64}\n"
+          "id name x flag\n";
+    constexpr std::size_t n_rows = 1000;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        ss << fmt::format("{} row{} {} {}\n", i, i, 0.5 * i, i % 20);
+    }
+    auto path = write_temp_file("tula_test_ecsv_filter.ecsv", ss.str());
+    auto file = tula::mmap_utils::MappedFile(path);
+    auto hdr = ECSVHeader::read_view(file.view());
+    auto data = file.view().substr(header_size(file.view()));
+    auto filter =
+        row_filter<int64_t>({"flag"}, [](auto flag) { return flag == 3; });
+    auto check = [&](auto &tbl) {
+        ASSERT_EQ(tbl.rows(), n_rows / 20);
+        for (std::size_t i = 0; i < tbl.rows(); ++i) {
+            EXPECT_EQ(tbl.template col<int64_t>("id")(i), 20 * i + 3);
+            EXPECT_EQ(tbl.template col<double>("x")(i), 0.5 * (20 * i + 3));
+        }
+    };
+    auto tbl = ECSVTable(hdr);
+    auto rows = ECSVTokenizer(data, ' ');
+    tbl.load_rows(rows, filter);
+    check(tbl);
+    EXPECT_EQ(tbl.col<std::string>("name")(1), "row23");
+    // the key columns need not be loaded, and multiple keys
+    for (std::size_t hint : {0, 50, 1000}) {
+        auto tbl1 = BasicECSVTable<TableLayout::staged>(
+            hdr, std::vector<std::string>{"id", "x"});
+        auto rows1 = ECSVTokenizer(data, ' ');
+        tbl1.load_rows(rows1, filter, hint);
+        check(tbl1);
+        EXPECT_THROW(tbl1.col<int64_t>("flag"), std::runtime_error);
+    }
+    auto tbl2 = ECSVTable(hdr, std::vector<std::string>{"name"});
+    auto rows2 = ECSVTokenizer(data, ' ');
+    tbl2.load_rows(rows2, row_filter<std::string, double>(
+                              {"name", "x"}, [](const auto &name, auto x) {
+                                  return name.ends_with('7') && x < 100;
+                              }));
+    ASSERT_EQ(tbl2.rows(), 20U);
+    EXPECT_EQ(tbl2.col<std::string>("name")(19), "row197");
+    // invalid keys
+    auto rows3 = ECSVTokenizer(data, ' ');
+    EXPECT_THROW(ECSVTable(hdr).load_rows(
+                     rows3, row_filter<double>({"flag"}, [](auto) {
+                         return true;
+                     })),
+                 std::runtime_error);
+    EXPECT_THROW(ECSVTable(hdr).load_rows(
+                     rows3, row_filter<double>({"y"}, [](auto) {
+                         return true;
+                     })),
+                 std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, table_col_map) {
+
+    using namespace tula::ecsv;
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: x, datatype: float64}\n"
+          "# - {name: y, datatype: float64}\n"
+          "id name x y\n";
+    constexpr std::size_t n_rows = 100;
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        ss << fmt::format("{} row{} {} {}\n", i, i, 0.5 * i, -0.5 * i);
+    }
+    auto path = write_temp_file("tula_test_ecsv_col_map.ecsv", ss.str());
+    auto tbl0 = ECSVTable::from_mmap(path);
+    auto x = tbl0.col_map<double>("x");
+    ASSERT_EQ(x.size(), n_rows);
+    EXPECT_TRUE((x == tbl0.col<double>("x").data).all());
+    EXPECT_EQ(x.data(), &tbl0.col<double>("x")(0));
+    x(1) = -1.;
+    EXPECT_EQ(tbl0.col<double>("x")(1), -1.);
+    auto names = tbl0.col_span<std::string>("name");
+    ASSERT_EQ(names.size(), n_rows);
+    EXPECT_EQ(names[3], "row3");
+    EXPECT_EQ(tbl0.col_span<int64_t>("id")[5], 5);
+    EXPECT_THROW(tbl0.col_map<double>("id"), std::runtime_error);
+    // the storage stays in place when the table is moved
+    auto tbl1 = std::move(tbl0);
+    EXPECT_EQ(tbl1.col_map<double>("x").data(), x.data());
+    const auto &ctbl1 = tbl1;
+    EXPECT_EQ(ctbl1.col_map<double>(2).sum(), x.sum());
+
+    auto tbl2 = BasicECSVTable<TableLayout::row_major>::from_mmap(path);
+    auto y = tbl2.col_map<double>("y");
+    EXPECT_EQ(y.innerStride(), 2);
+    EXPECT_EQ(y(3), -1.5);
+    EXPECT_EQ(tbl2.col_map<int64_t>("id").sum(), n_rows * (n_rows - 1) / 2);
+    auto tbl3 = ECSVTable::from_mmap_lazy(path);
+    EXPECT_EQ(tbl3.col_map<double>("x")(3), 1.5);
+
+    std::filesystem::remove(path);
+}
+
+TEST(ecsv, writer) {
+
+    using namespace tula::ecsv;
+    auto path = write_temp_file("tula_test_ecsv_writer.ecsv", apt_header);
+    auto tbl0 = ECSVTable::from_mmap(path);
+    std::stringstream ss;
+    {
+        auto writer = ECSVWriter(ss);
+        writer.write(tbl0);
+    }
+    std::filesystem::remove(path);
+    fmtlog("written:\n{}", ss.str());
+    auto hdr = ECSVHeader::read(ss);
+    EXPECT_TRUE(hdr.is_compatible(tbl0.header()));
+    EXPECT_EQ(hdr.cols()[0].description, tbl0.header().cols()[0].description);
+    EXPECT_EQ(hdr.cols()[10].unit, "um");
+    auto tbl = ECSVTable(std::move(hdr));
+    auto parser = aria::csv::CsvParser(ss).delimiter(tbl.header().delimiter());
+    tbl.load_rows(parser);
+    ASSERT_EQ(tbl.rows(), tbl0.rows());
+    EXPECT_EQ(tbl.col<std::string>("uid").data,
+              tbl0.col<std::string>("uid").data);
+    EXPECT_TRUE((tbl.col<int32_t>("nw").data == tbl0.col<int32_t>("nw").data)
+                    .all());
+    EXPECT_TRUE(
+        (tbl.col<double>("y").data == tbl0.col<double>("y").data).all());
+
+    // eigen blocks
+    Eigen::MatrixXd m(40000, 2);
+    m.col(0).setLinSpaced(0., 1.);
+    m.col(1).setRandom();
+    Eigen::VectorXi v = Eigen::VectorXi::LinSpaced(m.rows(), 0, 39999);
+    for (std::string ex_mode :
+         {std::string{"seq"},
+          std::string{tula::grppi_utils::default_mode_name()}}) {
+        std::stringstream ss1;
+        ECSVWriter(ss1, ex_mode).write({"a", "b", "i"}, YAML::Node{}, m, v);
+        auto tbl1 = ECSVTable(ECSVHeader::read(ss1));
+        auto rows = aria::csv::CsvParser(ss1).delimiter(' ');
+        tbl1.load_rows(rows);
+        ASSERT_EQ(tbl1.rows(), m.rows());
+        EXPECT_TRUE((tbl1.col<double>("b").data == m.col(1).array()).all());
+        EXPECT_TRUE((tbl1.col<int32_t>("i").data == v.array()).all());
+    }
+    std::stringstream ss2;
+    EXPECT_THROW(ECSVWriter(ss2).write({"a"}, YAML::Node{}, m), DumpError);
+
+    // names with the delimiter, space or quote chars are quoted
+    std::vector<std::string> names{"a b", "c,d", "e\"f", "g"};
+    Eigen::MatrixXd m3 = Eigen::MatrixXd::Random(5, 4);
+    std::stringstream ss3;
+    ECSVWriter(ss3).write(names, YAML::Node{}, m3);
+    fmtlog("written:\n{}", ss3.str());
+    auto path3 =
+        write_temp_file("tula_test_ecsv_writer_names.ecsv", ss3.str());
+    auto tbl3 = ECSVTable::from_mmap(path3);
+    std::filesystem::remove(path3);
+    EXPECT_TRUE(std::ranges::equal(tbl3.header().colnames(), names));
+    EXPECT_TRUE((tbl3.col<double>("e\"f").data == m3.col(2).array()).all());
+    std::vector<ECSVColumn> cols4;
+    for (const auto &name : names) {
+        cols4.push_back({name, "int64"});
+    }
+    std::stringstream ss4;
+    ECSVWriter(ss4).write_header(
+        ECSVHeader(cols4, YAML::Node{}, ',', std::nullopt, std::nullopt));
+    EXPECT_TRUE(
+        std::ranges::equal(ECSVHeader::read(ss4).colnames(), names));
+}
+
+constexpr std::size_t bm_n_cols = 30;
+
+// NOLINTNEXTLINE
+void BM_ecsv_load_rows_istringstream(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [hdr, rows] = make_synthetic_table(n_rows, bm_n_cols);
+    for (auto _ : state) {
+        // this is the per-cell stream conversion used previously
+        auto tbl = ECSVTable(hdr);
+        auto loader = tbl.loader();
+        int row_idx = 0;
+        for (const auto &row : rows) {
+            loader.ensure_row_size_for_index(row_idx);
+            for (std::size_t j = 0; j < row.size(); ++j) {
+                loader.visit_col(j, [&row_idx, &j, &row](auto colref) {
+                    using value_t = typename decltype(colref)::value_t;
+                    value_t value;
+                    std::istringstream(row.at(j)) >> value;
+                    colref.set_value(row_idx, value);
+                });
+            }
+            ++row_idx;
+        }
+        loader.truncate(row_idx);
+        benchmark::DoNotOptimize(tbl);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_load_rows_istringstream = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_load_rows_istringstream)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_load_rows(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [hdr, rows] = make_synthetic_table(n_rows, bm_n_cols);
+    for (auto _ : state) {
+        auto tbl = ECSVTable(hdr);
+        tbl.load_rows(rows);
+        benchmark::DoNotOptimize(tbl);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_load_rows = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_load_rows)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+constexpr std::size_t bm_n_cols_wide = 512;
+
+// NOLINTNEXTLINE
+void BM_ecsv_decode_visit_col(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_cols = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [hdr, rows] = make_synthetic_table(64, n_cols);
+    auto tbl = ECSVTable(hdr);
+    auto loader = tbl.loader();
+    loader.ensure_row_size_for_index(rows.size() - 1);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            const auto &row = rows[i];
+            for (std::size_t j = 0; j < n_cols; ++j) {
+                loader.visit_col(j, [&i, &j, &row](auto colref) {
+                    colref.decode_value(i, row[j]);
+                });
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(rows.size() * n_cols));
+}
+BENCHMARK(BM_ecsv_decode_visit_col)->Arg(bm_n_cols_wide);
+
+// NOLINTNEXTLINE
+void BM_ecsv_decode_plan(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_cols = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [hdr, rows] = make_synthetic_table(64, n_cols);
+    auto tbl = ECSVTable(hdr);
+    auto loader = tbl.loader();
+    loader.ensure_row_size_for_index(rows.size() - 1);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            loader.decode_row(i, rows[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(rows.size() * n_cols));
+}
+BENCHMARK(BM_ecsv_decode_plan)->Arg(bm_n_cols_wide);
+
+// NOLINTNEXTLINE
+template <tula::ecsv::GrowthPolicy policy>
+void BM_ecsv_array_data_growth(benchmark::State &state) {
+    using namespace tula::ecsv;
+    using dtypes_t = ECSVTable::table_data_traits::supported_dtypes_t;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    bool use_hint = state.range(1) > 0;
+    std::size_t n_reallocs{0};
+    std::size_t peak_bytes{0};
+    for (auto _ : state) {
+        n_reallocs = 0;
+        peak_bytes = 0;
+        std::apply(
+            [&](auto... dtypes) {
+                auto grow = [&](auto dtype) {
+                    using T = decltype(dtype);
+                    std::vector<ECSVColumn> cols;
+                    for (std::size_t j = 0; j < bm_n_cols; ++j) {
+                        cols.push_back({fmt::format("c{}", j), dtype_str<T>()});
+                    }
+                    auto hdr = ECSVHeader(std::move(cols), YAML::Node{},
+                                          spec::ECSV_DELIM_CHAR, std::nullopt,
+                                          std::nullopt);
+                    auto data =
+                        ArrayData<T, internal::array_data_block_size,
+                                  Eigen::ColMajor, policy>{hdr};
+                    auto row_bytes = sizeof(T) * bm_n_cols;
+                    auto old_rows = data.row_size();
+                    auto on_realloc = [&]() {
+                        ++n_reallocs;
+                        auto bytes = (old_rows + data.row_size()) * row_bytes;
+                        peak_bytes = std::max(peak_bytes, bytes);
+                        old_rows = data.row_size();
+                    };
+                    if (use_hint && data.reserve(n_rows)) {
+                        on_realloc();
+                    }
+                    for (std::size_t i = 0; i < n_rows; ++i) {
+                        if (data.ensure_row_size_for_index(i)) {
+                            on_realloc();
+                        }
+                    }
+                    data.truncate(n_rows);
+                    benchmark::DoNotOptimize(data);
+                };
+                (grow(dtypes), ...);
+            },
+            dtypes_t{});
+    }
+    state.counters["reallocs"] = static_cast<double>(n_reallocs);
+    state.counters["peak_bytes"] = static_cast<double>(peak_bytes);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_ecsv_array_data_growth, tula::ecsv::GrowthPolicy::block)
+    ->Args({1 << 14, 0})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ecsv_array_data_growth,
+                   tula::ecsv::GrowthPolicy::geometric)
+    ->Args({1 << 14, 0})
+    ->Args({1 << 14, 1})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ecsv_array_data_growth, tula::ecsv::GrowthPolicy::exact)
+    ->Args({1 << 14, 0})
+    ->Args({1 << 14, 1})
+    ->Unit(benchmark::kMillisecond);
+
+/// @brief Create synthetic ECSV file content for benchmarks.
+auto make_synthetic_ecsv(std::size_t n_rows, std::size_t n_cols) {
+    using namespace tula::ecsv;
+    auto [hdr, rows] = make_synthetic_table(n_rows, n_cols);
+    YAML::Node node;
+    for (const auto &col : hdr.cols()) {
+        auto n = (col.datatype == dtype_str<int64_t>())
+                     ? make_column_node<int64_t>(col.name)
+                     : make_column_node<double>(col.name);
+        node[std::string{spec::k_datatype}].push_back(n);
+    }
+    std::stringstream ss;
+    spec::dump_yaml_header(ss, node);
+    ss << fmt::format("{}\n", fmt::join(hdr.colnames(), " "));
+    for (const auto &row : rows) {
+        ss << fmt::format("{}\n", fmt::join(row, " "));
+    }
+    return ss.str();
+}
+
+// NOLINTNEXTLINE
+void BM_ecsv_read_ifstream(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    for (auto _ : state) {
+        std::ifstream fo(path);
+        auto tbl = ECSVTable(ECSVHeader::read(fo));
+        auto parser =
+            aria::csv::CsvParser(fo).delimiter(tbl.header().delimiter());
+        tbl.load_rows(parser);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_ifstream = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_read_ifstream)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_read_mmap(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    for (auto _ : state) {
+        auto tbl = ECSVTable::from_mmap(path);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_mmap = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_read_mmap)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+/// @brief Open \p n_files small files, for which the time is dominated by
+/// the header parsing.
+// NOLINTNEXTLINE
+void BM_ecsv_read_small_files(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_files = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto dir =
+        std::filesystem::temp_directory_path() / "tula_bench_ecsv_small";
+    std::filesystem::create_directories(dir);
+    constexpr std::size_t n_rows = 10;
+    auto content = make_synthetic_ecsv(n_rows, bm_n_cols);
+    std::vector<std::string> paths;
+    for (std::size_t f = 0; f < n_files; ++f) {
+        paths.push_back((dir / fmt::format("{}.ecsv", f)).string());
+        std::ofstream fo(paths.back());
+        fo << content;
+    }
+    for (auto _ : state) {
+        for (const auto &path : paths) {
+            auto tbl = ECSVTable::from_mmap(path);
+            benchmark::DoNotOptimize(tbl);
+        }
+    }
+    std::filesystem::remove_all(dir);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_small_files = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_read_small_files)
+        ->Arg(200)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+/// @brief Parse header from stream or from buffer.
+// NOLINTNEXTLINE
+void BM_ecsv_parse_header(benchmark::State &state, std::string mode) {
+    using namespace tula::ecsv;
+    std::string content{apt_header};
+    for (auto _ : state) {
+        if (mode == "stream") {
+            std::istringstream is{content};
+            auto hdr = ECSVHeader::read(is);
+            benchmark::DoNotOptimize(hdr);
+        } else {
+            auto hdr = ECSVHeader::read_view(content);
+            benchmark::DoNotOptimize(hdr);
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_ecsv_parse_header, stream, std::string{"stream"});
+BENCHMARK_CAPTURE(BM_ecsv_parse_header, view, std::string{"view"});
+
+/// @brief Read file with the column statistics collected when loading, or
+/// computed in a second pass over the columns.
+// NOLINTNEXTLINE
+void BM_ecsv_read_stats(benchmark::State &state, const std::string &mode) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read_stats.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    auto policy = mode == "collect" ? ColumnStatsPolicy::collect
+                                    : ColumnStatsPolicy::skip;
+    for (auto _ : state) {
+        auto tbl = ECSVTable::from_mmap(path, policy);
+        if (mode != "skip") {
+            for (auto idx : tbl.header_view().indices()) {
+                benchmark::DoNotOptimize(tbl.stats(idx));
+            }
+        }
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_stats = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_read_stats, skip, std::string{"skip"})
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_ecsv_read_stats, collect, std::string{"collect"})
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_ecsv_read_stats, second_pass,
+                      std::string{"second_pass"})
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+/// @brief Read 5% of the rows of file, by loading all rows and selecting
+/// or by filtering the rows when loading.
+// NOLINTNEXTLINE
+void BM_ecsv_read_filtered(benchmark::State &state, bool filtered) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read_filtered.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    // c0 is 30 * row index
+    auto keep = [](int64_t c0) { return (c0 / bm_n_cols) % 20 == 0; };
+    for (auto _ : state) {
+        auto file = tula::mmap_utils::MappedFile(path);
+        auto buf = file.view();
+        std::size_t data_offset{0};
+        auto tbl = ECSVTable(ECSVHeader::read_view(buf, &data_offset));
+        auto rows = ECSVTokenizer(buf.substr(data_offset), ' ');
+        if (filtered) {
+            tbl.load_rows(rows, row_filter<int64_t>({"c0"}, keep));
+            benchmark::DoNotOptimize(tbl);
+            continue;
+        }
+        tbl.load_rows(rows, count_lines(buf.substr(data_offset)));
+        std::vector<Eigen::Index> selected;
+        auto c0 = tbl.col<int64_t>("c0");
+        for (Eigen::Index i = 0; i < c0.data.size(); ++i) {
+            if (keep(c0(i))) {
+                selected.push_back(i);
+            }
+        }
+        for (auto idx : tbl.header_view().indices()) {
+            tbl.visit_array_data(idx, [&](const auto &array_data, auto j) {
+                if constexpr (TULA_DECAY(array_data)::is_eigen_data) {
+                    auto [data, stride] = array_data.col_data(j);
+                    std::vector<TULA_DECAY(*data)> values;
+                    values.reserve(selected.size());
+                    for (auto i : selected) {
+                        values.push_back(data[i * stride]);
+                    }
+                    benchmark::DoNotOptimize(values);
+                }
+            });
+        }
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_filtered = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_read_filtered, select, false)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_ecsv_read_filtered, filter, true)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+#if TULA_ECSV_HAS_ZLIB
+/// @brief Read gzip-compressed file, with the decompression on the same
+/// thread or overlapped with the parsing.
+// NOLINTNEXTLINE
+void BM_ecsv_read_gzip(benchmark::State &state, bool threaded) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_gzip_file("tula_bench_ecsv_read.ecsv.gz",
+                                     make_synthetic_ecsv(n_rows, bm_n_cols));
+    for (auto _ : state) {
+        auto file = tula::mmap_utils::MappedFile(path);
+        auto rows = ECSVGzipRows(
+            file.view(), GzipBlockReader::default_block_size, threaded);
+        auto tbl = ECSVTable(rows.header());
+        tbl.load_rows(rows);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_gzip = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_read_gzip, seq, false)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_ecsv_read_gzip, threaded, true)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+#endif
+
+/// @brief Create ECSV content with an int64 column and two string
+/// columns, of which the values are long enough to not fit in the small
+/// string buffer.
+auto make_synthetic_string_ecsv(std::size_t n_rows) {
+    std::stringstream ss;
+    ss << "# %ECSV 0.9\n# ---\n# datatype:\n"
+          "# - {name: id, datatype: int64}\n"
+          "# - {name: name, datatype: string}\n"
+          "# - {name: flag, datatype: string}\n"
+          "id name flag\n";
+    for (std::size_t i = 0; i < n_rows; ++i) {
+        auto flag = (i % 3 == 0) ? "saturated_pixel_flag" : "ok";
+        ss << fmt::format("{} source_{:08d}_{:04x}_detection {}\n", i, i,
+                          i % 4096, flag);
+    }
+    return ss.str();
+}
+
+// NOLINTNEXTLINE
+template <tula::ecsv::StringStorage string_storage>
+void BM_ecsv_read_strings(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read_strings.ecsv",
+                                make_synthetic_string_ecsv(n_rows));
+    std::size_t n_bytes{0};
+    for (auto _ : state) {
+        auto tbl =
+            BasicECSVTable<TableLayout::col_major, string_storage>::from_mmap(
+                path);
+        benchmark::DoNotOptimize(tbl);
+        // the memory held by the string columns
+        n_bytes = 0;
+        for (const auto &name : {std::string{"name"}, std::string{"flag"}}) {
+            if constexpr (string_storage == StringStorage::arena) {
+                const auto &arena =
+                    tbl.template col<std::string_view>(name).data;
+                n_bytes += arena.bytes().size() +
+                           (arena.size() + 1) * sizeof(StringArena::offset_t);
+            } else {
+                // the capacity of short strings is in the object itself
+                constexpr std::size_t sso_capacity = 15;
+                for (const auto &v :
+                     tbl.template col<std::string>(name).data) {
+                    n_bytes += sizeof(v);
+                    if (v.capacity() > sso_capacity) {
+                        n_bytes += v.capacity() + 1;
+                    }
+                }
+            }
+        }
+    }
+    std::filesystem::remove(path);
+    state.counters["bytes_per_row"] =
+        static_cast<double>(n_bytes) / static_cast<double>(n_rows);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_strings = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_TEMPLATE(BM_ecsv_read_strings, tula::ecsv::StringStorage::string)
+        ->Arg(1 << 18)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_TEMPLATE(BM_ecsv_read_strings, tula::ecsv::StringStorage::arena)
+        ->Arg(1 << 18)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+template <tula::ecsv::TableLayout layout>
+void BM_ecsv_read_layout(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read_layout.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    for (auto _ : state) {
+        auto tbl = BasicECSVTable<layout>::from_mmap(path);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_layout = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_TEMPLATE(BM_ecsv_read_layout, tula::ecsv::TableLayout::col_major)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_TEMPLATE(BM_ecsv_read_layout, tula::ecsv::TableLayout::row_major)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_TEMPLATE(BM_ecsv_read_layout, tula::ecsv::TableLayout::staged)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+/// @brief Sum the float64 columns of a table by column or by row.
+// NOLINTNEXTLINE
+template <tula::ecsv::TableLayout layout, bool by_row>
+void BM_ecsv_access_layout(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [hdr, rows] = make_synthetic_table(n_rows, bm_n_cols);
+    auto tbl = BasicECSVTable<layout>(hdr);
+    tbl.load_rows(rows);
+    const auto &data = tbl.template array_data<double>().array();
+    for (auto _ : state) {
+        if constexpr (by_row) {
+            Eigen::VectorXd sums(data.rows());
+            for (Eigen::Index i = 0; i < data.rows(); ++i) {
+                sums(i) = data.row(i).sum();
+            }
+            benchmark::DoNotOptimize(sums);
+        } else {
+            Eigen::VectorXd sums(data.cols());
+            for (Eigen::Index j = 0; j < data.cols(); ++j) {
+                sums(j) = data.col(j).sum();
+            }
+            benchmark::DoNotOptimize(sums);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * data.size());
+}
+[[maybe_unused]] const bool bm_ecsv_access_layout = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_TEMPLATE(BM_ecsv_access_layout,
+                       tula::ecsv::TableLayout::col_major, false)
+        ->Arg(1 << 16);
+    BENCHMARK_TEMPLATE(BM_ecsv_access_layout,
+                       tula::ecsv::TableLayout::row_major, false)
+        ->Arg(1 << 16);
+    BENCHMARK_TEMPLATE(BM_ecsv_access_layout,
+                       tula::ecsv::TableLayout::col_major, true)
+        ->Arg(1 << 16);
+    BENCHMARK_TEMPLATE(BM_ecsv_access_layout,
+                       tula::ecsv::TableLayout::row_major, true)
+        ->Arg(1 << 16);
+    return true;
+}();
+
+/// @brief Open file and access \p n_peek columns.
+// NOLINTNEXTLINE
+template <bool lazy>
+void BM_ecsv_read_peek(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto n_peek = tula::meta::size_cast<std::size_t>(state.range(1));
+    auto path = write_temp_file("tula_bench_ecsv_read_peek.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    for (auto _ : state) {
+        auto tbl = lazy ? ECSVTable::from_mmap_lazy(path)
+                        : ECSVTable::from_mmap(path);
+        for (std::size_t j = 0; j < n_peek; ++j) {
+            if (j % 3 == 0) {
+                benchmark::DoNotOptimize(tbl.col<int64_t>(j)(0));
+            } else {
+                benchmark::DoNotOptimize(tbl.col<double>(j)(0));
+            }
+        }
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_peek = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_TEMPLATE(BM_ecsv_read_peek, false)
+        ->Args({1 << 16, 2})
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_TEMPLATE(BM_ecsv_read_peek, true)
+        ->Args({1 << 16, 0})
+        ->Args({1 << 16, 2})
+        ->Args({1 << 16, bm_n_cols})
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+/// @brief Read the last 1% of rows with the row index, or with a full
+/// load and copy of the rows.
+// NOLINTNEXTLINE
+template <bool indexed>
+void BM_ecsv_read_slice(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read_slice.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    auto n = Eigen::Index(n_rows / 100);
+    auto slice = tula::container_utils::IndexSlice{-n, {}, {}};
+    auto index = row_index_cached(path);
+    for (auto _ : state) {
+        if constexpr (indexed) {
+            auto tbl = from_mmap_slice(path, index, slice);
+            benchmark::DoNotOptimize(tbl);
+        } else {
+            auto tbl = ECSVTable::from_mmap(path);
+            Eigen::MatrixXd data =
+                tbl.array_data<double>().array().bottomRows(n);
+            benchmark::DoNotOptimize(data);
+        }
+    }
+    std::filesystem::remove(ECSVRowIndex::default_path(path));
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0) / 100);
+}
+[[maybe_unused]] const bool bm_ecsv_read_slice = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_TEMPLATE(BM_ecsv_read_slice, false)
+        ->Arg(1 << 18)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_TEMPLATE(BM_ecsv_read_slice, true)
+        ->Arg(1 << 18)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_stream_mmap(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto n_cols_used = tula::meta::size_cast<std::size_t>(state.range(1));
+    auto path = write_temp_file("tula_bench_ecsv_read.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    std::vector<std::string> colnames;
+    for (std::size_t j = 0; j < n_cols_used; ++j) {
+        colnames.push_back(fmt::format("c{}", j));
+    }
+    for (auto _ : state) {
+        double sum{0};
+        stream_mmap(
+            path,
+            [&sum](auto &reader) {
+                sum += reader.template col<double>("c1").data.sum();
+            },
+            colnames);
+        benchmark::DoNotOptimize(sum);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_stream_mmap = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_stream_mmap)
+        ->Args({1 << 16, bm_n_cols})
+        ->Args({1 << 16, 3})
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_tokenize_csvparser(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto content = make_synthetic_ecsv(n_rows, bm_n_cols);
+    auto data = content.substr(header_size(content));
+    for (auto _ : state) {
+        std::istringstream is{data};
+        auto parser = aria::csv::CsvParser(is).delimiter(' ');
+        std::size_t n_fields{0};
+        for (const auto &row : parser) {
+            n_fields += row.size();
+        }
+        benchmark::DoNotOptimize(n_fields);
+    }
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(data.size()));
+}
+[[maybe_unused]] const bool bm_ecsv_tokenize_csvparser = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_tokenize_csvparser)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_tokenize(benchmark::State &state,
+                      tula::ecsv::internal::classify_t classify) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto content = make_synthetic_ecsv(n_rows, bm_n_cols);
+    auto data = std::string_view{content}.substr(header_size(content));
+    for (auto _ : state) {
+        auto tokenizer = ECSVTokenizer(data, ' ', classify);
+        std::size_t n_fields{0};
+        for (const auto &row : tokenizer) {
+            n_fields += row.size();
+        }
+        benchmark::DoNotOptimize(n_fields);
+    }
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(data.size()));
+}
+[[maybe_unused]] const bool bm_ecsv_tokenize = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_tokenize, scalar,
+                      &tula::ecsv::internal::classify_scalar)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_ecsv_tokenize, simd,
+                      tula::ecsv::internal::default_classify.second)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+/// @brief Create float64 data and column names for write benchmarks.
+auto make_write_bench_data(std::size_t n_rows) {
+    Eigen::MatrixXd data = Eigen::MatrixXd::Random(
+        tula::meta::size_cast<Eigen::Index>(n_rows), bm_n_cols);
+    std::vector<std::string> colnames;
+    for (std::size_t j = 0; j < bm_n_cols; ++j) {
+        colnames.push_back(fmt::format("c{}", j));
+    }
+    return std::tuple{std::move(data), std::move(colnames)};
+}
+
+// NOLINTNEXTLINE
+void BM_ecsv_write_fmt(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [data, colnames] = make_write_bench_data(n_rows);
+    auto path = (std::filesystem::temp_directory_path() /
+                 "tula_bench_ecsv_write.ecsv")
+                    .string();
+    for (auto _ : state) {
+        // this is the per-row formatting done by users previously
+        std::ofstream fo(path);
+        dump_header<std::ofstream, double>(fo, colnames, YAML::Node{});
+        fo << fmt::format("{}\n", fmt::join(colnames, " "));
+        for (Eigen::Index i = 0; i < data.rows(); ++i) {
+            fo << fmt::format("{}\n", fmt::join(data.row(i), " "));
+        }
+    }
+    auto n_bytes = static_cast<int64_t>(std::filesystem::file_size(path));
+    state.SetBytesProcessed(state.iterations() * n_bytes);
+    std::filesystem::remove(path);
+}
+[[maybe_unused]] const bool bm_ecsv_write_fmt = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_write_fmt)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_write(benchmark::State &state, std::string ex_mode) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto [data, colnames] = make_write_bench_data(n_rows);
+    auto path = (std::filesystem::temp_directory_path() /
+                 "tula_bench_ecsv_write.ecsv")
+                    .string();
+    for (auto _ : state) {
+        std::ofstream fo(path);
+        ECSVWriter(fo, ex_mode).write(colnames, YAML::Node{}, data);
+    }
+    auto n_bytes = static_cast<int64_t>(std::filesystem::file_size(path));
+    state.SetBytesProcessed(state.iterations() * n_bytes);
+    std::filesystem::remove(path);
+}
+[[maybe_unused]] const bool bm_ecsv_write = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_write, seq, std::string{"seq"})
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_ecsv_write, parallel,
+                      std::string{tula::grppi_utils::default_mode_name()})
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_read_cached(benchmark::State &state, bool warm) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    auto cachepath = cache::default_path(path);
+    std::filesystem::remove(cachepath);
+    if (warm) {
+        from_mmap_cached(path);
+    }
+    for (auto _ : state) {
+        if (!warm) {
+            state.PauseTiming();
+            std::filesystem::remove(cachepath);
+            state.ResumeTiming();
+        }
+        auto tbl = from_mmap_cached(path);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(cachepath);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_cached = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_read_cached, cold, false)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_ecsv_read_cached, warm, true)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_read_mmap_projected(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto n_cols_used = tula::meta::size_cast<std::size_t>(state.range(1));
+    auto path = write_temp_file("tula_bench_ecsv_read.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    std::vector<std::string> colnames;
+    for (std::size_t j = 0; j < n_cols_used; ++j) {
+        colnames.push_back(fmt::format("c{}", j));
+    }
+    for (auto _ : state) {
+        auto tbl = ECSVTable::from_mmap(path, colnames);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_mmap_projected = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_read_mmap_projected)
+        ->Args({1 << 16, bm_n_cols})
+        ->Args({1 << 16, 3})
+        ->Unit(benchmark::kMillisecond);
+    return true;
+}();
+
+// NOLINTNEXTLINE
+void BM_ecsv_read_mmap_parallel(benchmark::State &state) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto path = write_temp_file("tula_bench_ecsv_read.ecsv",
+                                make_synthetic_ecsv(n_rows, bm_n_cols));
+    for (auto _ : state) {
+        auto tbl = from_mmap_parallel(path);
+        benchmark::DoNotOptimize(tbl);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_mmap_parallel = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK(BM_ecsv_read_mmap_parallel)
+        ->Arg(1 << 16)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+
+/// @brief Read \p n_files files of the same columns to one table, with
+/// a loop that appends each file, or with from_mmap_concat.
+// NOLINTNEXTLINE
+void BM_ecsv_read_concat(benchmark::State &state, std::string ex_mode) {
+    using namespace tula::ecsv;
+    auto n_rows = tula::meta::size_cast<std::size_t>(state.range(0));
+    auto n_files = tula::meta::size_cast<std::size_t>(state.range(1));
+    auto content = make_synthetic_ecsv(n_rows / n_files, bm_n_cols);
+    std::vector<std::string> paths;
+    for (std::size_t f = 0; f < n_files; ++f) {
+        paths.push_back(write_temp_file(
+            fmt::format("tula_bench_ecsv_concat_{}.ecsv", f), content));
+    }
+    for (auto _ : state) {
+        if (ex_mode.empty()) {
+            // grow the data for each file
+            Eigen::MatrixXd data;
+            for (const auto &path : paths) {
+                auto tbl = ECSVTable::from_mmap(path);
+                const auto &d = tbl.array_data<double>().array();
+                auto n = data.rows();
+                data.conservativeResize(n + d.rows(), d.cols());
+                data.bottomRows(d.rows()) = d;
+            }
+            benchmark::DoNotOptimize(data);
+        } else {
+            auto tbl = from_mmap_concat(paths, ex_mode);
+            benchmark::DoNotOptimize(tbl);
+        }
+    }
+    for (const auto &path : paths) {
+        std::filesystem::remove(path);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+[[maybe_unused]] const bool bm_ecsv_read_concat = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_ecsv_read_concat, loop, std::string{})
+        ->Args({1 << 16, 16})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_ecsv_read_concat, seq, std::string{"seq"})
+        ->Args({1 << 16, 16})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_ecsv_read_concat, parallel,
+                      std::string{tula::grppi_utils::default_mode_name()})
+        ->Args({1 << 16, 16})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+
 } // namespace
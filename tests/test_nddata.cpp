@@ -1,11 +1,25 @@
 #include <gtest/gtest.h>
 
 #include "test_common.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <tula/formatter/matrix.h>
 #include <tula/logging.h>
 #include <tula/nddata/cacheddata.h>
 #include <tula/nddata/eigen.h>
+#include <tula/nddata/mmap.h>
+#include <tula/nddata/tiled.h>
 
 namespace {
 
@@ -48,6 +62,287 @@ TEST(nddata, eigen_data) {
     EXPECT_EQ(pp()(0, 0), 8.);
 }
 
+auto write_temp_matrix(const std::string &name, const Eigen::MatrixXd &m,
+                       std::size_t offset = 0) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os << std::string(offset, '\0');
+    os.write(reinterpret_cast<const char *>(m.data()), // NOLINT
+             static_cast<std::streamsize>(m.size() * sizeof(double)));
+    return path;
+}
+
+// NOLINTNEXTLINE
+TEST(nddata, mmap_eigen_data) {
+    using namespace tula::nddata;
+    using tula::mmap_utils::Advice;
+    using tula::mmap_utils::MapMode;
+    Eigen::MatrixXd m{{0, 1, 2, 3}, {4, 5, 6, 7}, {8, 9, 10, 11}};
+    auto path = write_temp_matrix("tula_test_mmap_eigen_data.bin", m);
+    auto mm = MmapEigenData<double>(path, 3, 4);
+    EXPECT_TRUE(mm() == m);
+    EXPECT_EQ(mm.size_bytes(), 96U);
+    mm.advise(Advice::sequential);
+    mm.advise(Advice::willneed, 1, 2);
+    EXPECT_THROW(mm.file().mutable_data(), std::runtime_error);
+    // inferred and fixed size
+    EXPECT_TRUE(MmapEigenData<double>(path, Eigen::Dynamic, 4)() == m);
+    EXPECT_TRUE((MmapEigenData<double, 3, 4>(path)() == m));
+    auto mr = MmapEigenData<double, Eigen::Dynamic, 3, Eigen::RowMajor>(path);
+    EXPECT_EQ(mr().rows(), 4);
+    EXPECT_TRUE(mr() == m.transpose());
+    EXPECT_THROW(MmapEigenData<double>(path, 4, 4), std::runtime_error);
+    EXPECT_THROW((MmapEigenData<double, 4, 4>(path)), std::runtime_error);
+    EXPECT_THROW(MmapEigenData<double>(path, 3, 4, 1), std::runtime_error);
+    // the size has to match the file
+    EXPECT_THROW(MmapEigenData<double>(path, 2, 4), std::runtime_error);
+    EXPECT_THROW(MmapEigenData<double>(path, Eigen::Dynamic, 5),
+                 std::runtime_error);
+    EXPECT_THROW((MmapEigenData<double, 2, 4>(path)), std::runtime_error);
+    // offset
+    auto path1 = write_temp_matrix("tula_test_mmap_eigen_data1.bin", m, 16);
+    EXPECT_TRUE(MmapEigenData<double>(path1, 3, Eigen::Dynamic, 16)() == m);
+    EXPECT_THROW(MmapEigenData<double>(path1, 3, 4), std::runtime_error);
+    EXPECT_THROW(MmapEigenData<double>(path1, 3, 4, 8), std::runtime_error);
+    // copy on write
+    using cow_t = MmapEigenData<double, Eigen::Dynamic, Eigen::Dynamic,
+                                Eigen::ColMajor, MapMode::copy_on_write>;
+    auto mc = cow_t(path, 3, 4);
+    mc().col(1).setConstant(-1);
+    EXPECT_EQ(mc()(2, 1), -1);
+    EXPECT_EQ(mm()(2, 1), 9);
+    EXPECT_TRUE(MmapEigenData<double>(path, 3, 4)() == m);
+    // moved object keeps the mapping
+    auto mc1 = std::move(mc);
+    EXPECT_EQ(mc1()(0, 1), -1);
+    std::filesystem::remove(path);
+    std::filesystem::remove(path1);
+}
+
+/// @brief Sum the columns of matrix of \p state.range(0) MiB, mapped from
+/// a file written with the data, with the advice \p advice.
+// NOLINTNEXTLINE
+void BM_mmap_eigen_colwise_sum(benchmark::State &state,
+                               tula::mmap_utils::Advice advice) {
+    using namespace tula::nddata;
+    // one MiB per column
+    constexpr Eigen::Index n_rows = (1 << 20) / sizeof(double);
+    auto n_cols = state.range(0);
+    auto path = (std::filesystem::temp_directory_path() /
+                 "tula_bench_mmap_eigen_data.bin")
+                    .string();
+    {
+        std::ofstream os(path, std::ios::binary | std::ios::trunc);
+        Eigen::VectorXd col(n_rows);
+        for (Eigen::Index j = 0; j < n_cols; ++j) {
+            col.setConstant(double(j));
+            os.write(reinterpret_cast<const char *>(col.data()), // NOLINT
+                     static_cast<std::streamsize>(n_rows * sizeof(double)));
+        }
+        if (!os) {
+            state.SkipWithError("unable to write the data file");
+            return;
+        }
+    }
+    for (auto _ : state) {
+        auto mm = MmapEigenData<double>(path, n_rows, n_cols);
+        mm.advise(advice);
+        Eigen::RowVectorXd sums = mm().colwise().sum();
+        benchmark::DoNotOptimize(sums);
+    }
+    std::filesystem::remove(path);
+    state.SetBytesProcessed(state.iterations() * state.range(0) *
+                            (std::int64_t(1) << 20));
+}
+[[maybe_unused]] const bool bm_mmap_eigen_colwise_sum = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_mmap_eigen_colwise_sum, normal,
+                      tula::mmap_utils::Advice::normal)
+        ->Arg(256)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_mmap_eigen_colwise_sum, sequential,
+                      tula::mmap_utils::Advice::sequential)
+        ->Arg(256)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_mmap_eigen_colwise_sum, random,
+                      tula::mmap_utils::Advice::random)
+        ->Arg(256)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+// The out-of-core case writes a file larger than the memory, so it is only
+// registered with TULA_BENCH_OUT_OF_CORE set to the file size in GiB.
+[[maybe_unused]] const bool bm_mmap_eigen_colwise_sum_out_of_core = [] {
+    const auto *size_gib = std::getenv("TULA_BENCH_OUT_OF_CORE");
+    if (size_gib == nullptr || std::atoll(size_gib) <= 0) {
+        return false;
+    }
+    benchmark::RegisterBenchmark("BM_mmap_eigen_colwise_sum/out_of_core",
+                                 BM_mmap_eigen_colwise_sum,
+                                 tula::mmap_utils::Advice::sequential)
+        ->Arg(std::atoll(size_gib) << 10)
+        ->Iterations(1)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+
+// NOLINTNEXTLINE
+TEST(nddata, tiled_eigen_data) {
+    using namespace tula::nddata;
+    Eigen::MatrixXd m = Eigen::MatrixXd::Random(10, 7);
+    auto tt = TiledEigenData<double, 4, 3>(m);
+    EXPECT_EQ(tt.n_tile_rows(), 3);
+    EXPECT_EQ(tt.n_tile_cols(), 3);
+    EXPECT_EQ(tt.n_tiles(), 9);
+    EXPECT_EQ(tt().size(), 9U * 4 * 3);
+    EXPECT_TRUE(tt.to_eigen() == m);
+    EXPECT_EQ(tt.coeff(9, 6), m(9, 6));
+    // edge tiles map the valid region only
+    EXPECT_EQ(tt.tile(2, 2).rows(), 2);
+    EXPECT_EQ(tt.tile(2, 2).cols(), 1);
+    EXPECT_TRUE(tt.tile(1, 2) == m.block(4, 6, 4, 1));
+    auto [ti, tj] = tt.tile_index(5);
+    EXPECT_EQ(ti, 2);
+    EXPECT_EQ(tj, 1);
+    EXPECT_TRUE(tt.tile(5) == m.block(8, 3, 2, 3));
+    Eigen::Index n = 0;
+    for (const auto &t : tt.tiles()) {
+        n += t.size();
+    }
+    EXPECT_EQ(n, m.size());
+    // NDData view
+    auto ref = std::as_const(tt).tile_ref(1, 1);
+    EXPECT_TRUE(ref() == m.block(4, 3, 4, 3));
+    auto wref = tt.tile_ref(2, 0);
+    static_assert(
+        std::is_same_v<decltype(wref),
+                       EigenDataRef<TiledEigenData<double, 4, 3>::tile_t>>);
+    auto wtile = wref();
+    wtile(1, 2) = 3;
+    m(9, 2) = 3;
+    EXPECT_EQ(tt.coeff(9, 2), 3);
+    // write through the views
+    tt.tile(0, 1).setConstant(-1);
+    m.block(0, 3, 4, 3).setConstant(-1);
+    EXPECT_TRUE(ref() == m.block(4, 3, 4, 3));
+    EXPECT_TRUE(tt.to_eigen() == m);
+    tt.coeffRef(9, 6) = 5;
+    m(9, 6) = 5;
+    EXPECT_TRUE(tt.to_eigen() == m);
+    // parallel_for_tiles
+    std::vector<int> visited(std::size_t(tt.n_tiles()), 0);
+    tt.parallel_for_tiles([&](auto t, auto ti_, auto tj_) {
+        t.array() *= 2;
+        ++visited[std::size_t(tj_ * tt.n_tile_rows() + ti_)];
+    });
+    EXPECT_TRUE(tt.to_eigen() == m * 2);
+    EXPECT_TRUE(std::all_of(visited.begin(), visited.end(),
+                            [](auto v) { return v == 1; }));
+    std::atomic<Eigen::Index> n_coeffs{0};
+    std::as_const(tt).parallel_for_tiles(
+        "seq", [&](auto t, auto, auto) { n_coeffs += t.size(); });
+    EXPECT_EQ(n_coeffs, m.size());
+    // the errors of the kernel are rethrown
+    auto bad_kernel = [](auto, auto ti_, auto tj_) {
+        if (ti_ == 1 && tj_ == 2) {
+            throw std::runtime_error("bad tile");
+        }
+    };
+    for (auto ex_mode : {std::string_view{"seq"},
+                         tula::grppi_utils::default_mode_name()}) {
+        EXPECT_THROW(tt.parallel_for_tiles(ex_mode, bad_kernel),
+                     std::runtime_error);
+    }
+    EXPECT_TRUE(tt.to_eigen() == m * 2);
+    EXPECT_TRUE((TiledEigenData<double>(0, 3).n_tiles() == 0));
+    EXPECT_THROW(TiledEigenData<double>(-1, 3), std::runtime_error);
+}
+
+enum class TraversalKind {
+    plain_colwise,
+    plain_rowwise,
+    tiled,
+    tiled_parallel,
+};
+
+/// @brief Update a 4096 x 4096 matrix with a kernel that walks the rows
+/// in the inner loop, which is cache-unfriendly for column-major data,
+/// either over the full matrix or tile by tile.
+// NOLINTNEXTLINE
+void BM_tiled_traversal(benchmark::State &state, TraversalKind kind) {
+    using namespace tula::nddata;
+    constexpr Eigen::Index n = 4096;
+    auto kernel = [](auto &&x) {
+        for (Eigen::Index i = 0; i < x.rows(); ++i) {
+            for (Eigen::Index j = 0; j < x.cols(); ++j) {
+                x.coeffRef(i, j) = x.coeff(i, j) * 0.5 + 1.;
+            }
+        }
+    };
+    Eigen::MatrixXd m = Eigen::MatrixXd::Random(n, n);
+    auto tt = TiledEigenData<double>(m);
+    for (auto _ : state) {
+        switch (kind) {
+        case TraversalKind::plain_colwise: {
+            for (Eigen::Index j = 0; j < n; ++j) {
+                auto c = m.col(j);
+                kernel(c);
+            }
+            benchmark::DoNotOptimize(m.data());
+            break;
+        }
+        case TraversalKind::plain_rowwise: {
+            kernel(m);
+            benchmark::DoNotOptimize(m.data());
+            break;
+        }
+        case TraversalKind::tiled: {
+            for (auto t : tt.tiles()) {
+                kernel(t);
+            }
+            benchmark::DoNotOptimize(tt().data());
+            break;
+        }
+        case TraversalKind::tiled_parallel: {
+            tt.parallel_for_tiles(
+                [&](auto t, auto /*ti*/, auto /*tj*/) { kernel(t); });
+            benchmark::DoNotOptimize(tt().data());
+            break;
+        }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * n * n *
+                            std::int64_t(sizeof(double)));
+}
+[[maybe_unused]] const bool bm_tiled_traversal = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_tiled_traversal, plain_colwise,
+                      TraversalKind::plain_colwise)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_tiled_traversal, plain_rowwise,
+                      TraversalKind::plain_rowwise)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_tiled_traversal, tiled, TraversalKind::tiled)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_tiled_traversal, tiled_parallel,
+                      TraversalKind::tiled_parallel)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+
 struct TestCachedData {
 
     struct some_value_evaluator {
@@ -121,6 +416,8 @@ TEST(nddata, cached_data) {
     EXPECT_EQ(td2.some_other_value_invalidate().some_other_value(), 4);
 
     // move
+    static_assert(std::is_nothrow_move_constructible_v<TestCachedData>);
+    static_assert(std::is_nothrow_move_assignable_v<TestCachedData>);
     auto td3 = std::move(td);
     EXPECT_EQ(td3.some_value(), 2);
     EXPECT_EQ(td3.some_value_invalidate().some_value(), 4);
@@ -128,4 +425,270 @@ TEST(nddata, cached_data) {
     EXPECT_EQ(td3.some_other_value_invalidate().some_other_value(), 4);
 }
 
+/// @brief Cached getters of the graph a -> b -> d <- c, counting the
+/// evaluations of each.
+struct TestCachedDataDeps {
+    struct a_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> int {
+            ++self.n_evaluated[0];
+            return self.input;
+        }
+    };
+    struct b_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> int {
+            ++self.n_evaluated[1];
+            return self.a() * 2;
+        }
+    };
+    struct c_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> int {
+            ++self.n_evaluated[2];
+            return 100;
+        }
+    };
+    struct d_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> int {
+            ++self.n_evaluated[3];
+            return self.b() + self.c();
+        }
+    };
+    TULA_CACHED_GETTER(a, int);
+    TULA_CACHED_GETTER_DEPS(b, int, a);
+    TULA_CACHED_GETTER(c, int);
+    TULA_CACHED_GETTER_DEPS(d, int, b, c);
+
+public:
+    int input{1};
+    mutable std::array<int, 4> n_evaluated{};
+};
+
+// NOLINTNEXTLINE
+TEST(nddata, cached_data_deps) {
+
+    using n_t = std::array<int, 4>;
+    auto td = TestCachedDataDeps{};
+    EXPECT_EQ(td.d(), 102);
+    EXPECT_EQ(td.n_evaluated, (n_t{1, 1, 1, 1}));
+    EXPECT_EQ(td.d(), 102);
+    EXPECT_EQ(td.n_evaluated, (n_t{1, 1, 1, 1}));
+    // only the downstream of a are evaluated again
+    td.input = 2;
+    td.a_invalidate();
+    EXPECT_EQ(td.d(), 104);
+    EXPECT_EQ(td.n_evaluated, (n_t{2, 2, 1, 2}));
+    // invalidating d does not evaluate its inputs
+    td.d_invalidate();
+    EXPECT_EQ(td.d(), 104);
+    EXPECT_EQ(td.n_evaluated, (n_t{2, 2, 1, 3}));
+    td.c_invalidate();
+    EXPECT_EQ(td.b(), 4);
+    EXPECT_EQ(td.n_evaluated, (n_t{2, 2, 1, 3}));
+    const auto &ctd = td;
+    EXPECT_EQ(ctd.d(), 104);
+    EXPECT_EQ(td.n_evaluated, (n_t{2, 2, 2, 4}));
+    // copy keeps the recorded generations
+    auto td2 = td;
+    EXPECT_EQ(td2.d(), 104);
+    EXPECT_EQ(td2.n_evaluated, (n_t{2, 2, 2, 4}));
+    td2.input = 3;
+    td2.a_invalidate();
+    EXPECT_EQ(td2.b(), 6);
+    EXPECT_EQ(td2.d(), 106);
+    EXPECT_EQ(td2.n_evaluated, (n_t{3, 3, 2, 5}));
+    EXPECT_EQ(td.d(), 104);
+}
+
+/// @brief Cached getter that takes \p delay to evaluate.
+struct TestSlowCachedData {
+    struct value_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> double {
+            ++self.n_evaluated;
+            self.thread_id = std::this_thread::get_id();
+            if (self.fail) {
+                throw std::runtime_error("failed to evaluate value");
+            }
+            if (self.other != nullptr) {
+                return self.other->value();
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            double x{0};
+            while (std::chrono::steady_clock::now() - t0 < self.delay) {
+                x += 1.;
+            }
+            benchmark::DoNotOptimize(x);
+            return 0.5;
+        }
+    };
+    struct scaled_value_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> double {
+            return self.value() * 2;
+        }
+    };
+    TULA_CACHED_GETTER(value, double);
+    TULA_CACHED_GETTER_DEPS(scaled_value, double, value);
+
+public:
+    std::chrono::milliseconds delay{10};
+    mutable int n_evaluated{0};
+    mutable std::thread::id thread_id{};
+    bool fail{false};
+    /// @brief The object to read the value from instead.
+    const TestSlowCachedData *other{nullptr};
+};
+
+// NOLINTNEXTLINE
+TEST(nddata, cached_data_prefetch) {
+
+    auto td = TestSlowCachedData{};
+    td.value_prefetch();
+    td.value_prefetch();
+    EXPECT_EQ(td.value(), 0.5);
+    EXPECT_EQ(td.n_evaluated, 1);
+    EXPECT_NE(td.thread_id, std::this_thread::get_id());
+    // no-op when evaluated
+    td.value_prefetch();
+    EXPECT_EQ(td.value(), 0.5);
+    EXPECT_EQ(td.n_evaluated, 1);
+    // the dependencies are evaluated on the worker too
+    td.value_invalidate();
+    td.scaled_value_prefetch();
+    EXPECT_EQ(td.scaled_value(), 1.);
+    EXPECT_EQ(td.n_evaluated, 2);
+    EXPECT_NE(td.thread_id, std::this_thread::get_id());
+    // copy waits for the pending evaluation
+    td.value_invalidate();
+    td.value_prefetch();
+    auto td2 = td;
+    EXPECT_EQ(td2.n_evaluated, 3);
+    EXPECT_EQ(td2.value(), 0.5);
+    EXPECT_EQ(td2.n_evaluated, 3);
+    // the error of the prefetch is raised by the next call only
+    td2.value_invalidate();
+    td2.fail = true;
+    td2.value_prefetch();
+    EXPECT_THROW(td2.value(), std::runtime_error);
+    EXPECT_EQ(td2.n_evaluated, 4);
+    td2.fail = false;
+    EXPECT_EQ(td2.value(), 0.5);
+    EXPECT_EQ(td2.n_evaluated, 5);
+    EXPECT_EQ(td2.thread_id, std::this_thread::get_id());
+    // the worker of one object raises the prefetch error of the other
+    auto td4 = TestSlowCachedData{};
+    td4.fail = true;
+    td4.value_prefetch();
+    auto td5 = TestSlowCachedData{};
+    td5.other = &td4;
+    td5.value_prefetch();
+    EXPECT_THROW(td5.value(), std::runtime_error);
+    td4.fail = false;
+    EXPECT_EQ(td4.value(), 0.5);
+    static_assert(std::is_nothrow_move_constructible_v<TestSlowCachedData>);
+    // the pending evaluation is waited for on destruction
+    {
+        auto td3 = TestSlowCachedData{};
+        td3.value_prefetch();
+    }
+}
+
+/// @brief Read a cached getter after some I/O, with the evaluation
+/// prefetched before the I/O or not.
+// NOLINTNEXTLINE
+void BM_cached_getter_prefetch(benchmark::State &state, bool prefetch) {
+    for (auto _ : state) {
+        auto td = TestSlowCachedData{};
+        if (prefetch) {
+            td.value_prefetch();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        benchmark::DoNotOptimize(td.value());
+    }
+}
+[[maybe_unused]] const bool bm_cached_getter_prefetch = [] {
+    if (!tula::testing::bench_enabled()) {
+        return false;
+    }
+    BENCHMARK_CAPTURE(BM_cached_getter_prefetch, sync, false)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    BENCHMARK_CAPTURE(BM_cached_getter_prefetch, prefetch, true)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    return true;
+}();
+
+struct TestSharedCachedData {
+    struct value_evaluator {
+        template <typename T>
+        static auto evaluate(T &self) -> double {
+            ++self.n_evaluated;
+            return 0.5;
+        }
+    };
+    TULA_CACHED_GETTER(value, double);
+
+public:
+    mutable std::atomic<int> n_evaluated{0};
+};
+
+// NOLINTNEXTLINE
+TEST(nddata, cached_data_threads) {
+
+    const auto td = TestSharedCachedData{};
+    constexpr int n_threads = 8;
+    constexpr int n_reads = 10000;
+    auto read = [&] {
+        double sum{0};
+        for (int i = 0; i < n_reads; ++i) {
+            sum += td.value();
+        }
+        EXPECT_EQ(sum, 0.5 * n_reads);
+    };
+    for (int k = 0; k < 2; ++k) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < n_threads; ++i) {
+            threads.emplace_back(read);
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        EXPECT_EQ(td.n_evaluated, k + 1);
+        td.value_invalidate();
+    }
+}
+
+/// @brief Read a cached getter shared by all threads.
+// NOLINTNEXTLINE
+void BM_cached_getter(benchmark::State &state) {
+    static const auto td = TestSharedCachedData{};
+    double sum{0};
+    for (auto _ : state) {
+        sum += td.value();
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_cached_getter)->ThreadRange(1, 8)->UseRealTime();
+
+/// @brief Read a value guarded by a mutex shared by all threads, which is
+/// what the cached getter did for every read.
+// NOLINTNEXTLINE
+void BM_locked_getter(benchmark::State &state) {
+    static std::mutex mutex;
+    static double value{0.5};
+    double sum{0};
+    for (auto _ : state) {
+        std::scoped_lock lock(mutex);
+        sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_locked_getter)->ThreadRange(1, 8)->UseRealTime();
+
 } // namespace